@@ -0,0 +1,7 @@
+BENCHES=codec_bench pipeline_bench
+codec_bench_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,codec_bench.o bench_frames.o \
+	codec.o transform.o)
+pipeline_bench_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,pipeline_bench.o \
+	bench_counters.o bench_frames.o publisher.o channel.o command.o \
+	stream_variant.o encoding.o codec.o transform.o worker_pool.o config.o \
+	metrics.o)
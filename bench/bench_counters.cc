@@ -0,0 +1,41 @@
+#include "bench_counters.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> allocations(0);
+
+}  // namespace
+
+// operator new[] and the nothrow forms all end up here.
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+namespace lptc_coderdojo {
+
+size_t GetAllocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+void SetFrameCounters(benchmark::State& state, size_t frames, size_t bytes,
+                      size_t allocations) {
+  state.counters["ns_per_frame"] = benchmark::Counter(
+      frames / 1e9, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["allocs_per_frame"] =
+      frames ? (double)allocations / frames : 0;
+  state.SetBytesProcessed(bytes);
+  state.SetItemsProcessed(frames);
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,23 @@
+#ifndef LPTC_CODERDOJO_BENCH_COUNTERS_H_
+#define LPTC_CODERDOJO_BENCH_COUNTERS_H_
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+
+namespace lptc_coderdojo {
+
+// Calls to the global operator new by any thread since the program started.
+// Linking bench_counters.o replaces the global operator new and delete to
+// keep the count.
+size_t GetAllocationCount();
+
+// Reports the counters every pipeline benchmark shares: ns_per_frame,
+// allocs_per_frame and, through Google Benchmark, bytes_per_second. `bytes`
+// is the frame data the benchmark moved or produced.
+void SetFrameCounters(benchmark::State& state, size_t frames, size_t bytes,
+                      size_t allocations);
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_BENCH_COUNTERS_H_
@@ -0,0 +1,123 @@
+#include "bench_frames.h"
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+const int kSyntheticWidth = 640;
+const int kSyntheticHeight = 480;
+const size_t kSyntheticFrames = 8;
+const size_t kMaxRecordedFrames = 64;
+const uint16_t kNoReading = 2047;
+
+// fakenect stores depth as "P5 <width> <height> 65535" followed by the
+// samples in the byte order of the recording machine, little-endian in
+// practice, rather than the big-endian order of the PGM spec.
+bool LoadFakenectDepth(const std::string& path, int* width, int* height,
+                       std::vector<uint16_t>* frame) {
+  FILE* fp = std::fopen(path.c_str(), "rb");
+  if (!fp) return false;
+
+  int max_value = 0;
+  bool ok = std::fscanf(fp, "P5 %d %d %d", width, height, &max_value) == 3 &&
+            max_value == 65535 && std::fgetc(fp) != EOF;
+  if (ok) {
+    frame->resize((size_t)*width * *height);
+    ok = std::fread(frame->data(), sizeof(uint16_t), frame->size(), fp) ==
+         frame->size();
+  }
+  std::fclose(fp);
+  return ok;
+}
+
+void LoadRecordedFrames(const char* dir_name,
+                        lptc_coderdojo::BenchDepthFrames* bench) {
+  DIR* dir = opendir(dir_name);
+  if (!dir) {
+    std::cerr << "!!!Error: Cannot open " << dir_name << std::endl;
+    return;
+  }
+
+  std::vector<std::string> names;
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name(entry->d_name);
+    if (name.compare(0, 2, "d-") == 0 && name.size() > 4 &&
+        name.compare(name.size() - 4, 4, ".pgm") == 0)
+      names.push_back(name);
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  if (names.size() > kMaxRecordedFrames) names.resize(kMaxRecordedFrames);
+
+  for (const std::string& name : names) {
+    int width, height;
+    std::vector<uint16_t> frame;
+    if (!LoadFakenectDepth(std::string(dir_name) + "/" + name, &width,
+                           &height, &frame)) {
+      std::cerr << "!!!Error: Skipping unreadable frame " << name << std::endl;
+      continue;
+    }
+    if (bench->frames.empty()) {
+      bench->width = width;
+      bench->height = height;
+    } else if (width != bench->width || height != bench->height) {
+      continue;
+    }
+    bench->frames.push_back(frame);
+  }
+}
+
+// A floor sloping away from the camera, a box in front of it, its shadow
+// and a frame edge without readings, as raw 11-bit disparity.
+void SynthesizeFrames(lptc_coderdojo::BenchDepthFrames* bench) {
+  std::mt19937 rng(42);
+  std::normal_distribution<double> noise(0.0, 1.5);
+  std::bernoulli_distribution dropout(0.01);
+
+  bench->width = kSyntheticWidth;
+  bench->height = kSyntheticHeight;
+  for (size_t f = 0; f < kSyntheticFrames; f++) {
+    std::vector<uint16_t> frame((size_t)bench->width * bench->height);
+    int box_x = 200 + (int)f * 8;
+    for (int y = 0; y < bench->height; y++) {
+      for (int x = 0; x < bench->width; x++) {
+        double depth = 700 + y * 0.4;
+        bool in_box = x >= box_x && x < box_x + 160 && y >= 150 && y < 330;
+        bool in_shadow =
+            x >= box_x + 160 && x < box_x + 190 && y >= 150 && y < 330;
+        if (in_box) depth = 600 + (x - box_x) * 0.1;
+
+        uint16_t sample = (uint16_t)(depth + noise(rng));
+        if (x < 8 || in_shadow || dropout(rng)) sample = kNoReading;
+        frame[(size_t)y * bench->width + x] = sample;
+      }
+    }
+    bench->frames.push_back(frame);
+  }
+}
+
+lptc_coderdojo::BenchDepthFrames LoadBenchDepthFrames() {
+  lptc_coderdojo::BenchDepthFrames bench;
+  const char* dir_name = std::getenv("KINECT_BENCH_FRAMES");
+  if (dir_name) LoadRecordedFrames(dir_name, &bench);
+  if (bench.frames.empty()) SynthesizeFrames(&bench);
+  return bench;
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+const BenchDepthFrames& GetBenchDepthFrames() {
+  static const BenchDepthFrames bench = LoadBenchDepthFrames();
+  return bench;
+}
+
+}  // namespace lptc_coderdojo
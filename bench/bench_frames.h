@@ -0,0 +1,24 @@
+#ifndef LPTC_CODERDOJO_BENCH_FRAMES_H_
+#define LPTC_CODERDOJO_BENCH_FRAMES_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Depth frames the benchmarks run on, all the same size.
+struct BenchDepthFrames {
+  int width;
+  int height;
+  std::vector<std::vector<uint16_t>> frames;
+};
+
+// Loads the depth frames of a fakenect recording from the directory named by
+// the KINECT_BENCH_FRAMES environment variable. Without it, or when it has no
+// usable frames, synthesizes frames with the structure of a real scene:
+// smooth surfaces, sensor noise and "no reading" shadows.
+const BenchDepthFrames& GetBenchDepthFrames();
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_BENCH_FRAMES_H_
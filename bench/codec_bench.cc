@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_frames.h"
+#include "codec.h"
+#include "transform.h"
+
+namespace {
+
+// Reports compression against raw 16-bit samples and the time spent per
+// pixel, on top of Google Benchmark's time per iteration.
+void SetCodecCounters(benchmark::State& state, size_t pixels,
+                      size_t encoded_bytes) {
+  state.counters["ratio"] =
+      (double)(pixels * sizeof(uint16_t)) / encoded_bytes;
+  state.counters["ns_per_pixel"] = benchmark::Counter(
+      pixels / 1e9, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.SetItemsProcessed(pixels);
+}
+
+void BM_EncodeRvl(benchmark::State& state) {
+  const lptc_coderdojo::BenchDepthFrames& bench =
+      lptc_coderdojo::GetBenchDepthFrames();
+  size_t frame_pixels = (size_t)bench.width * bench.height;
+  std::vector<uint8_t> encoded(lptc_coderdojo::GetRvlMaxSize(frame_pixels));
+  size_t pixels = 0;
+  size_t encoded_bytes = 0;
+  size_t next = 0;
+
+  for (auto _ : state) {
+    const std::vector<uint16_t>& frame = bench.frames[next];
+    encoded_bytes +=
+        lptc_coderdojo::EncodeRvl(frame.data(), frame_pixels, encoded.data());
+    pixels += frame_pixels;
+    next = (next + 1) % bench.frames.size();
+  }
+  SetCodecCounters(state, pixels, encoded_bytes);
+}
+BENCHMARK(BM_EncodeRvl);
+
+void BM_DecodeRvl(benchmark::State& state) {
+  const lptc_coderdojo::BenchDepthFrames& bench =
+      lptc_coderdojo::GetBenchDepthFrames();
+  size_t frame_pixels = (size_t)bench.width * bench.height;
+  std::vector<std::vector<uint8_t>> encoded;
+  for (const std::vector<uint16_t>& frame : bench.frames) {
+    std::vector<uint8_t> buf(lptc_coderdojo::GetRvlMaxSize(frame_pixels));
+    buf.resize(
+        lptc_coderdojo::EncodeRvl(frame.data(), frame_pixels, buf.data()));
+    encoded.push_back(buf);
+  }
+  std::vector<uint16_t> decoded(frame_pixels);
+  size_t pixels = 0;
+  size_t encoded_bytes = 0;
+  size_t next = 0;
+
+  for (auto _ : state) {
+    const std::vector<uint8_t>& buf = encoded[next];
+    benchmark::DoNotOptimize(lptc_coderdojo::DecodeRvl(
+        buf.data(), buf.size(), decoded.data(), frame_pixels));
+    encoded_bytes += buf.size();
+    pixels += frame_pixels;
+    next = (next + 1) % encoded.size();
+  }
+  SetCodecCounters(state, pixels, encoded_bytes);
+}
+BENCHMARK(BM_DecodeRvl);
+
+// Baseline: the fixed 11/16 ratio of the packed 11-bit encoding.
+void BM_EncodePacked11(benchmark::State& state) {
+  const lptc_coderdojo::BenchDepthFrames& bench =
+      lptc_coderdojo::GetBenchDepthFrames();
+  size_t frame_pixels = (size_t)bench.width * bench.height;
+  std::vector<uint8_t> packed(lptc_coderdojo::GetPacked11Size(frame_pixels));
+  size_t pixels = 0;
+  size_t next = 0;
+
+  for (auto _ : state) {
+    lptc_coderdojo::TransformDepthToPacked11(bench.frames[next].data(),
+                                             packed.data(), frame_pixels);
+    benchmark::ClobberMemory();
+    pixels += frame_pixels;
+    next = (next + 1) % bench.frames.size();
+  }
+  SetCodecCounters(state, pixels, packed.size() * state.iterations());
+}
+BENCHMARK(BM_EncodePacked11);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,272 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_counters.h"
+#include "bench_frames.h"
+#include "channel.h"
+#include "command.h"
+#include "frame_queue.h"
+#include "publisher.h"
+#include "transform.h"
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+const int kVideoWidth = 640;
+const int kVideoHeight = 480;
+
+// Hands out the same depth frame every time it is asked, so publishing
+// benchmarks measure serialization rather than waiting for a device.
+class BenchKinectDevice : public lptc_coderdojo::KinectDevice {
+ public:
+  explicit BenchKinectDevice(const lptc_coderdojo::BenchDepthFrames& bench)
+      : width(bench.width),
+        height(bench.height),
+        depth(new lptc_coderdojo::Frame<uint16_t>()) {
+    depth->data = bench.frames[0];
+    depth->timestamp = 0;
+  }
+
+  int GetDepthFrameWidth() { return width; }
+  int GetDepthFrameHeight() { return height; }
+  int GetDepthFrameRectSize() { return width * height; }
+  int GetVideoFrameWidth() { return width; }
+  int GetVideoFrameHeight() { return height; }
+  int GetVideoFrameRectSize() { return width * height; }
+  lptc_coderdojo::VideoFormat GetVideoFormat() {
+    return lptc_coderdojo::VideoFormat::RGB;
+  }
+  lptc_coderdojo::DepthFormat GetDepthFormat() {
+    return lptc_coderdojo::DepthFormat::RAW11;
+  }
+  bool GetNextDepthFrame(lptc_coderdojo::DepthFramePtr& frame) {
+    depth->timestamp++;
+    frame = depth;
+    return true;
+  }
+  bool GetNextVideoFrame(lptc_coderdojo::VideoFramePtr&) { return false; }
+  bool GetNextRgbdFrame(lptc_coderdojo::RgbdFrame&) { return false; }
+  void StartVideo() {}
+  void StartDepth() {}
+  void StartRgbd() {}
+  void StopVideo() {}
+  void StopDepth() {}
+  void StopRgbd() {}
+  void Shutdown() {}
+  lptc_coderdojo::StreamStats GetDepthStats() { return {0, 0}; }
+  lptc_coderdojo::StreamStats GetVideoStats() { return {0, 0}; }
+  lptc_coderdojo::StreamStats GetRgbdStats() { return {0, 0}; }
+
+ private:
+  const int width;
+  const int height;
+  lptc_coderdojo::DepthFramePtr depth;
+};
+
+// Stands in for a websocket subscriber, counting what it is sent.
+class CountingSink : public lptc_coderdojo::ChannelSink {
+ public:
+  CountingSink() : bytes(0) {}
+
+  void Consume(const lptc_coderdojo::StreamVariant&, void const* data,
+               size_t len) {
+    benchmark::DoNotOptimize(data);
+    bytes += len;
+  }
+
+  size_t bytes;
+};
+
+void BM_FrameQueuePushPop(benchmark::State& state) {
+  lptc_coderdojo::FrameQueue<uint16_t> queue(
+      lptc_coderdojo::kDefaultFrameQueueDepth);
+  lptc_coderdojo::FramePool<uint16_t> pool(1, kVideoWidth * kVideoHeight);
+  lptc_coderdojo::DepthFramePtr frame = pool.Acquire();
+  size_t frame_bytes = frame->data.size() * sizeof(uint16_t);
+  size_t frames = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    queue.Push(std::move(frame));
+    queue.Pop(frame);
+    frames++;
+  }
+  lptc_coderdojo::SetFrameCounters(
+      state, frames, frames * frame_bytes,
+      lptc_coderdojo::GetAllocationCount() - allocations);
+}
+BENCHMARK(BM_FrameQueuePushPop);
+
+// A device callback thread filling pooled frames and a publisher popping
+// them, as in the server. The queue blocks, so no frame is dropped.
+void BM_FrameQueueHandoff(benchmark::State& state) {
+  lptc_coderdojo::FrameQueue<uint16_t> queue(
+      lptc_coderdojo::kDefaultFrameQueueDepth,
+      lptc_coderdojo::OverflowPolicy::BLOCK);
+  lptc_coderdojo::FramePool<uint16_t> pool(
+      lptc_coderdojo::kDefaultFrameQueueDepth + 2, kVideoWidth * kVideoHeight);
+  size_t frame_bytes = kVideoWidth * kVideoHeight * sizeof(uint16_t);
+  std::atomic<bool> done(false);
+  std::thread producer([&] {
+    while (!done) {
+      lptc_coderdojo::DepthFramePtr frame = pool.Acquire();
+      if (frame) queue.Push(std::move(frame));
+    }
+  });
+  lptc_coderdojo::DepthFramePtr frame;
+  size_t frames = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    queue.Pop(frame);
+    frame.reset();
+    frames++;
+  }
+  lptc_coderdojo::SetFrameCounters(
+      state, frames, frames * frame_bytes,
+      lptc_coderdojo::GetAllocationCount() - allocations);
+
+  done = true;
+  queue.Close();
+  producer.join();
+}
+BENCHMARK(BM_FrameQueueHandoff)->UseRealTime();
+
+// Runs one benchmark per kernel the CPU supports.
+void AddKernelArgs(benchmark::internal::Benchmark* b) {
+  for (size_t i = 0; i < lptc_coderdojo::GetSupportedTransformKernels().size();
+       i++) {
+    b->Arg(i);
+  }
+}
+
+void BM_TransformDepthToRgba(benchmark::State& state) {
+  const lptc_coderdojo::TransformKernels& kernels =
+      lptc_coderdojo::GetSupportedTransformKernels()[state.range(0)];
+  const lptc_coderdojo::BenchDepthFrames& bench =
+      lptc_coderdojo::GetBenchDepthFrames();
+  size_t pixels = (size_t)bench.width * bench.height;
+  std::vector<uint8_t> rgba(pixels * 4);
+  size_t frames = 0;
+  size_t next = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    kernels.depth_to_rgba(bench.frames[next].data(), rgba.data(), pixels);
+    benchmark::ClobberMemory();
+    frames++;
+    next = (next + 1) % bench.frames.size();
+  }
+  lptc_coderdojo::SetFrameCounters(
+      state, frames, frames * rgba.size(),
+      lptc_coderdojo::GetAllocationCount() - allocations);
+  state.SetLabel(kernels.isa);
+}
+BENCHMARK(BM_TransformDepthToRgba)->Apply(AddKernelArgs);
+
+void BM_TransformRgbToRgba(benchmark::State& state) {
+  const lptc_coderdojo::TransformKernels& kernels =
+      lptc_coderdojo::GetSupportedTransformKernels()[state.range(0)];
+  size_t pixels = (size_t)kVideoWidth * kVideoHeight;
+  std::vector<uint8_t> rgb(pixels * 3);
+  for (size_t i = 0; i < rgb.size(); i++) rgb[i] = (uint8_t)(i * 7);
+  std::vector<uint8_t> rgba(pixels * 4);
+  size_t frames = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    kernels.rgb_to_rgba(rgb.data(), rgba.data(), pixels);
+    benchmark::ClobberMemory();
+    frames++;
+  }
+  lptc_coderdojo::SetFrameCounters(
+      state, frames, frames * rgba.size(),
+      lptc_coderdojo::GetAllocationCount() - allocations);
+  state.SetLabel(kernels.isa);
+}
+BENCHMARK(BM_TransformRgbToRgba)->Apply(AddKernelArgs);
+
+// Serializes a depth frame into a protocol message for one subscriber, the
+// whole publishing path short of the network. Bytes are message bytes.
+void BM_SerializeDepthMessage(benchmark::State& state) {
+  lptc_coderdojo::StreamVariant variant;
+  variant.encoding = static_cast<lptc_coderdojo::Encoding>(state.range(0));
+  BenchKinectDevice device(lptc_coderdojo::GetBenchDepthFrames());
+  lptc_coderdojo::WorkerPool pool(0);
+  lptc_coderdojo::DepthDataPublisher publisher(device, pool);
+  lptc_coderdojo::AsioServer server;
+  lptc_coderdojo::Channel channel(
+      "depth", server,
+      lptc_coderdojo::DepthDataPublisher::GetSupportedEncodings(
+          device.GetDepthFormat()));
+  std::shared_ptr<CountingSink> sink = std::make_shared<CountingSink>();
+  channel.AttachSink(sink, variant);
+  size_t frames = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    publisher.PublishNewData(&channel);
+    frames++;
+  }
+  lptc_coderdojo::SetFrameCounters(
+      state, frames, sink->bytes,
+      lptc_coderdojo::GetAllocationCount() - allocations);
+  state.SetLabel(lptc_coderdojo::EncodingName(variant.encoding));
+}
+BENCHMARK(BM_SerializeDepthMessage)
+    ->Arg(static_cast<int>(lptc_coderdojo::Encoding::RGBA))
+    ->Arg(static_cast<int>(lptc_coderdojo::Encoding::RAW16))
+    ->Arg(static_cast<int>(lptc_coderdojo::Encoding::PACKED11))
+    ->Arg(static_cast<int>(lptc_coderdojo::Encoding::RVL));
+
+// Bytes are the subscribe command's bytes; a frame is one command.
+void BM_CommandFromMessagePayload(benchmark::State& state) {
+  const std::string payload =
+      "SUBSCRIBE kinect0/depth format=rvl fps=15 scale=2 filter=box";
+  size_t commands = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        lptc_coderdojo::Command::FromMessagePayload(payload));
+    commands++;
+  }
+  lptc_coderdojo::SetFrameCounters(
+      state, commands, commands * payload.size(),
+      lptc_coderdojo::GetAllocationCount() - allocations);
+}
+BENCHMARK(BM_CommandFromMessagePayload);
+
+// Fans a raw depth frame out to N in-process subscribers. Bytes are the
+// bytes delivered to all of them.
+void BM_ChannelPublish(benchmark::State& state) {
+  const lptc_coderdojo::BenchDepthFrames& bench =
+      lptc_coderdojo::GetBenchDepthFrames();
+  const std::vector<uint16_t>& frame = bench.frames[0];
+  lptc_coderdojo::StreamVariant variant;
+  lptc_coderdojo::AsioServer server;
+  lptc_coderdojo::Channel channel("depth", server,
+                                  {lptc_coderdojo::Encoding::RGBA});
+  std::vector<std::shared_ptr<CountingSink>> sinks;
+  for (int i = 0; i < state.range(0); i++) {
+    sinks.push_back(std::make_shared<CountingSink>());
+    channel.AttachSink(sinks.back(), variant);
+  }
+  size_t frames = 0;
+
+  size_t allocations = lptc_coderdojo::GetAllocationCount();
+  for (auto _ : state) {
+    channel.Publish(variant, frame.data(), frame.size() * sizeof(uint16_t));
+    frames++;
+  }
+  size_t bytes = 0;
+  for (const std::shared_ptr<CountingSink>& sink : sinks) bytes += sink->bytes;
+  lptc_coderdojo::SetFrameCounters(
+      state, frames, bytes, lptc_coderdojo::GetAllocationCount() - allocations);
+}
+BENCHMARK(BM_ChannelPublish)->RangeMultiplier(4)->Range(1, 64);
+
+}  // namespace
+
+BENCHMARK_MAIN();
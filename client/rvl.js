@@ -0,0 +1,56 @@
+// Decoder for the DepthRvl data type. Mirrors DecodeRvl in src/codec.cc:
+// alternating runs of zero and non-zero samples, non-zero samples stored as
+// zigzag deltas, every value a chain of 4-bit nibbles packed most
+// significant first into little-endian 32-bit words. Samples are XORed with
+// RVL_SAMPLE_KEY so "no reading" (2047) is coded as zero.
+var RVL_SAMPLE_KEY = 0x7FF;
+
+var decodeRvl = function(bytes, pixels) {
+  const view = new DataView(bytes.buffer, bytes.byteOffset,
+                            bytes.byteLength - bytes.byteLength % 4);
+  const depth = new Uint16Array(pixels);
+  let pos = 0;
+  let word = 0;
+  let nibbles = 0;
+
+  const readVle = function() {
+    let value = 0;
+    let shift = 0;
+    let nibble;
+    do {
+      if (nibbles === 0) {
+        if (pos >= view.byteLength) {
+          throw new Error("Truncated RVL frame");
+        }
+        word = view.getUint32(pos, true);
+        pos += 4;
+        nibbles = 8;
+      }
+      nibble = word >>> 28;
+      word = (word << 4) >>> 0;
+      nibbles--;
+      value += (nibble & 0x7) * Math.pow(2, shift);
+      shift += 3;
+    } while (nibble & 0x8);
+    return value;
+  };
+
+  let i = 0;
+  let previous = 0;
+  while (i < pixels) {
+    const zeros = readVle();
+    const nonzeros = readVle();
+    if (i + zeros + nonzeros > pixels) {
+      throw new Error("RVL frame larger than " + pixels + " samples");
+    }
+    for (let j = 0; j < zeros; j++) {
+      depth[i++] = RVL_SAMPLE_KEY;
+    }
+    for (let j = 0; j < nonzeros; j++) {
+      const positive = readVle();
+      previous += (positive % 2) ? -(positive + 1) / 2 : positive / 2;
+      depth[i++] = (previous & 0xFFFF) ^ RVL_SAMPLE_KEY;
+    }
+  }
+  return depth;
+};
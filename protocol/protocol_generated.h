@@ -11,19 +11,23 @@ namespace protocol {
 
 struct DeviceData;
 
+struct RgbdData;
+
 struct Message;
 
 enum class MessageType : uint8_t {
   Error = 0,
   DeviceData = 1,
+  RgbdData = 2,
   MIN = Error,
-  MAX = DeviceData
+  MAX = RgbdData
 };
 
-inline const MessageType (&EnumValuesMessageType())[2] {
+inline const MessageType (&EnumValuesMessageType())[3] {
   static const MessageType values[] = {
     MessageType::Error,
-    MessageType::DeviceData
+    MessageType::DeviceData,
+    MessageType::RgbdData
   };
   return values;
 }
@@ -32,13 +36,14 @@ inline const char * const *EnumNamesMessageType() {
   static const char * const names[] = {
     "Error",
     "DeviceData",
+    "RgbdData",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameMessageType(MessageType e) {
-  if (e < MessageType::Error || e > MessageType::DeviceData) return "";
+  if (e < MessageType::Error || e > MessageType::RgbdData) return "";
   const size_t index = static_cast<int>(e);
   return EnumNamesMessageType()[index];
 }
@@ -46,14 +51,24 @@ inline const char *EnumNameMessageType(MessageType e) {
 enum class DataType : uint8_t {
   Depth = 0,
   Video = 1,
+  DepthRaw16 = 2,
+  DepthPacked11 = 3,
+  VideoRgb = 4,
+  DepthRvl = 5,
+  VideoJpeg = 6,
   MIN = Depth,
-  MAX = Video
+  MAX = VideoJpeg
 };
 
-inline const DataType (&EnumValuesDataType())[2] {
+inline const DataType (&EnumValuesDataType())[7] {
   static const DataType values[] = {
     DataType::Depth,
-    DataType::Video
+    DataType::Video,
+    DataType::DepthRaw16,
+    DataType::DepthPacked11,
+    DataType::VideoRgb,
+    DataType::DepthRvl,
+    DataType::VideoJpeg
   };
   return values;
 }
@@ -62,13 +77,18 @@ inline const char * const *EnumNamesDataType() {
   static const char * const names[] = {
     "Depth",
     "Video",
+    "DepthRaw16",
+    "DepthPacked11",
+    "VideoRgb",
+    "DepthRvl",
+    "VideoJpeg",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameDataType(DataType e) {
-  if (e < DataType::Depth || e > DataType::Video) return "";
+  if (e < DataType::Depth || e > DataType::VideoJpeg) return "";
   const size_t index = static_cast<int>(e);
   return EnumNamesDataType()[index];
 }
@@ -77,7 +97,11 @@ struct DeviceData FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
     VT_TYPE = 4,
     VT_DEPTH = 6,
-    VT_VIDEO = 8
+    VT_VIDEO = 8,
+    VT_DEPTH_RAW = 10,
+    VT_WIDTH = 12,
+    VT_HEIGHT = 14,
+    VT_DEVICE_TIMESTAMP = 16
   };
   DataType type() const {
     return static_cast<DataType>(GetField<uint8_t>(VT_TYPE, 0));
@@ -88,6 +112,18 @@ struct DeviceData FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const flatbuffers::Vector<uint8_t> *video() const {
     return GetPointer<const flatbuffers::Vector<uint8_t> *>(VT_VIDEO);
   }
+  const flatbuffers::Vector<uint16_t> *depth_raw() const {
+    return GetPointer<const flatbuffers::Vector<uint16_t> *>(VT_DEPTH_RAW);
+  }
+  uint16_t width() const {
+    return GetField<uint16_t>(VT_WIDTH, 0);
+  }
+  uint16_t height() const {
+    return GetField<uint16_t>(VT_HEIGHT, 0);
+  }
+  uint32_t device_timestamp() const {
+    return GetField<uint32_t>(VT_DEVICE_TIMESTAMP, 0);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint8_t>(verifier, VT_TYPE) &&
@@ -95,6 +131,11 @@ struct DeviceData FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.VerifyVector(depth()) &&
            VerifyOffset(verifier, VT_VIDEO) &&
            verifier.VerifyVector(video()) &&
+           VerifyOffset(verifier, VT_DEPTH_RAW) &&
+           verifier.VerifyVector(depth_raw()) &&
+           VerifyField<uint16_t>(verifier, VT_WIDTH) &&
+           VerifyField<uint16_t>(verifier, VT_HEIGHT) &&
+           VerifyField<uint32_t>(verifier, VT_DEVICE_TIMESTAMP) &&
            verifier.EndTable();
   }
 };
@@ -111,6 +152,18 @@ struct DeviceDataBuilder {
   void add_video(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> video) {
     fbb_.AddOffset(DeviceData::VT_VIDEO, video);
   }
+  void add_depth_raw(flatbuffers::Offset<flatbuffers::Vector<uint16_t>> depth_raw) {
+    fbb_.AddOffset(DeviceData::VT_DEPTH_RAW, depth_raw);
+  }
+  void add_width(uint16_t width) {
+    fbb_.AddElement<uint16_t>(DeviceData::VT_WIDTH, width, 0);
+  }
+  void add_height(uint16_t height) {
+    fbb_.AddElement<uint16_t>(DeviceData::VT_HEIGHT, height, 0);
+  }
+  void add_device_timestamp(uint32_t device_timestamp) {
+    fbb_.AddElement<uint32_t>(DeviceData::VT_DEVICE_TIMESTAMP, device_timestamp, 0);
+  }
   explicit DeviceDataBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -127,10 +180,18 @@ inline flatbuffers::Offset<DeviceData> CreateDeviceData(
     flatbuffers::FlatBufferBuilder &_fbb,
     DataType type = DataType::Depth,
     flatbuffers::Offset<flatbuffers::Vector<uint8_t>> depth = 0,
-    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> video = 0) {
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> video = 0,
+    flatbuffers::Offset<flatbuffers::Vector<uint16_t>> depth_raw = 0,
+    uint16_t width = 0,
+    uint16_t height = 0,
+    uint32_t device_timestamp = 0) {
   DeviceDataBuilder builder_(_fbb);
+  builder_.add_device_timestamp(device_timestamp);
+  builder_.add_depth_raw(depth_raw);
   builder_.add_video(video);
   builder_.add_depth(depth);
+  builder_.add_height(height);
+  builder_.add_width(width);
   builder_.add_type(type);
   return builder_.Finish();
 }
@@ -139,14 +200,85 @@ inline flatbuffers::Offset<DeviceData> CreateDeviceDataDirect(
     flatbuffers::FlatBufferBuilder &_fbb,
     DataType type = DataType::Depth,
     const std::vector<uint8_t> *depth = nullptr,
-    const std::vector<uint8_t> *video = nullptr) {
+    const std::vector<uint8_t> *video = nullptr,
+    const std::vector<uint16_t> *depth_raw = nullptr,
+    uint16_t width = 0,
+    uint16_t height = 0,
+    uint32_t device_timestamp = 0) {
   auto depth__ = depth ? _fbb.CreateVector<uint8_t>(*depth) : 0;
   auto video__ = video ? _fbb.CreateVector<uint8_t>(*video) : 0;
+  auto depth_raw__ = depth_raw ? _fbb.CreateVector<uint16_t>(*depth_raw) : 0;
   return lptc_coderdojo::protocol::CreateDeviceData(
       _fbb,
       type,
       depth__,
-      video__);
+      video__,
+      depth_raw__,
+      width,
+      height,
+      device_timestamp);
+}
+
+struct RgbdData FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_DEPTH = 4,
+    VT_VIDEO = 6,
+    VT_SKEW = 8
+  };
+  const DeviceData *depth() const {
+    return GetPointer<const DeviceData *>(VT_DEPTH);
+  }
+  const DeviceData *video() const {
+    return GetPointer<const DeviceData *>(VT_VIDEO);
+  }
+  int32_t skew() const {
+    return GetField<int32_t>(VT_SKEW, 0);
+  }
+  bool Verify(flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_DEPTH) &&
+           verifier.VerifyTable(depth()) &&
+           VerifyOffset(verifier, VT_VIDEO) &&
+           verifier.VerifyTable(video()) &&
+           VerifyField<int32_t>(verifier, VT_SKEW) &&
+           verifier.EndTable();
+  }
+};
+
+struct RgbdDataBuilder {
+  flatbuffers::FlatBufferBuilder &fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_depth(flatbuffers::Offset<DeviceData> depth) {
+    fbb_.AddOffset(RgbdData::VT_DEPTH, depth);
+  }
+  void add_video(flatbuffers::Offset<DeviceData> video) {
+    fbb_.AddOffset(RgbdData::VT_VIDEO, video);
+  }
+  void add_skew(int32_t skew) {
+    fbb_.AddElement<int32_t>(RgbdData::VT_SKEW, skew, 0);
+  }
+  explicit RgbdDataBuilder(flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  RgbdDataBuilder &operator=(const RgbdDataBuilder &);
+  flatbuffers::Offset<RgbdData> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<RgbdData>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<RgbdData> CreateRgbdData(
+    flatbuffers::FlatBufferBuilder &_fbb,
+    flatbuffers::Offset<DeviceData> depth = 0,
+    flatbuffers::Offset<DeviceData> video = 0,
+    int32_t skew = 0) {
+  RgbdDataBuilder builder_(_fbb);
+  builder_.add_skew(skew);
+  builder_.add_video(video);
+  builder_.add_depth(depth);
+  return builder_.Finish();
 }
 
 struct Message FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
@@ -154,7 +286,8 @@ struct Message FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_TIMESTAMP = 4,
     VT_TYPE = 6,
     VT_ERROR = 8,
-    VT_DATA = 10
+    VT_DATA = 10,
+    VT_RGBD = 12
   };
   uint64_t timestamp() const {
     return GetField<uint64_t>(VT_TIMESTAMP, 0);
@@ -168,6 +301,9 @@ struct Message FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const DeviceData *data() const {
     return GetPointer<const DeviceData *>(VT_DATA);
   }
+  const RgbdData *rgbd() const {
+    return GetPointer<const RgbdData *>(VT_RGBD);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint64_t>(verifier, VT_TIMESTAMP) &&
@@ -176,6 +312,8 @@ struct Message FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.VerifyString(error()) &&
            VerifyOffset(verifier, VT_DATA) &&
            verifier.VerifyTable(data()) &&
+           VerifyOffset(verifier, VT_RGBD) &&
+           verifier.VerifyTable(rgbd()) &&
            verifier.EndTable();
   }
 };
@@ -195,6 +333,9 @@ struct MessageBuilder {
   void add_data(flatbuffers::Offset<DeviceData> data) {
     fbb_.AddOffset(Message::VT_DATA, data);
   }
+  void add_rgbd(flatbuffers::Offset<RgbdData> rgbd) {
+    fbb_.AddOffset(Message::VT_RGBD, rgbd);
+  }
   explicit MessageBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -212,9 +353,11 @@ inline flatbuffers::Offset<Message> CreateMessage(
     uint64_t timestamp = 0,
     MessageType type = MessageType::Error,
     flatbuffers::Offset<flatbuffers::String> error = 0,
-    flatbuffers::Offset<DeviceData> data = 0) {
+    flatbuffers::Offset<DeviceData> data = 0,
+    flatbuffers::Offset<RgbdData> rgbd = 0) {
   MessageBuilder builder_(_fbb);
   builder_.add_timestamp(timestamp);
+  builder_.add_rgbd(rgbd);
   builder_.add_data(data);
   builder_.add_error(error);
   builder_.add_type(type);
@@ -226,14 +369,16 @@ inline flatbuffers::Offset<Message> CreateMessageDirect(
     uint64_t timestamp = 0,
     MessageType type = MessageType::Error,
     const char *error = nullptr,
-    flatbuffers::Offset<DeviceData> data = 0) {
+    flatbuffers::Offset<DeviceData> data = 0,
+    flatbuffers::Offset<RgbdData> rgbd = 0) {
   auto error__ = error ? _fbb.CreateString(error) : 0;
   return lptc_coderdojo::protocol::CreateMessage(
       _fbb,
       timestamp,
       type,
       error__,
-      data);
+      data,
+      rgbd);
 }
 
 inline const lptc_coderdojo::protocol::Message *GetMessage(const void *buf) {
@@ -17,7 +17,8 @@ lptc_coderdojo.protocol = lptc_coderdojo.protocol || {};
  */
 lptc_coderdojo.protocol.MessageType = {
   Error: 0, 0: 'Error',
-  DeviceData: 1, 1: 'DeviceData'
+  DeviceData: 1, 1: 'DeviceData',
+  RgbdData: 2, 2: 'RgbdData'
 };
 
 /**
@@ -25,7 +26,12 @@ lptc_coderdojo.protocol.MessageType = {
  */
 lptc_coderdojo.protocol.DataType = {
   Depth: 0, 0: 'Depth',
-  Video: 1, 1: 'Video'
+  Video: 1, 1: 'Video',
+  DepthRaw16: 2, 2: 'DepthRaw16',
+  DepthPacked11: 3, 3: 'DepthPacked11',
+  VideoRgb: 4, 4: 'VideoRgb',
+  DepthRvl: 5, 5: 'DepthRvl',
+  VideoJpeg: 6, 6: 'VideoJpeg'
 };
 
 /**
@@ -121,11 +127,60 @@ lptc_coderdojo.protocol.DeviceData.prototype.videoArray = function() {
   return offset ? new Uint8Array(this.bb.bytes().buffer, this.bb.bytes().byteOffset + this.bb.__vector(this.bb_pos + offset), this.bb.__vector_len(this.bb_pos + offset)) : null;
 };
 
+/**
+ * @param {number} index
+ * @returns {number}
+ */
+lptc_coderdojo.protocol.DeviceData.prototype.depthRaw = function(index) {
+  var offset = this.bb.__offset(this.bb_pos, 10);
+  return offset ? this.bb.readUint16(this.bb.__vector(this.bb_pos + offset) + index * 2) : 0;
+};
+
+/**
+ * @returns {number}
+ */
+lptc_coderdojo.protocol.DeviceData.prototype.depthRawLength = function() {
+  var offset = this.bb.__offset(this.bb_pos, 10);
+  return offset ? this.bb.__vector_len(this.bb_pos + offset) : 0;
+};
+
+/**
+ * @returns {Uint16Array}
+ */
+lptc_coderdojo.protocol.DeviceData.prototype.depthRawArray = function() {
+  var offset = this.bb.__offset(this.bb_pos, 10);
+  return offset ? new Uint16Array(this.bb.bytes().buffer, this.bb.bytes().byteOffset + this.bb.__vector(this.bb_pos + offset), this.bb.__vector_len(this.bb_pos + offset)) : null;
+};
+
+/**
+ * @returns {number}
+ */
+lptc_coderdojo.protocol.DeviceData.prototype.width = function() {
+  var offset = this.bb.__offset(this.bb_pos, 12);
+  return offset ? this.bb.readUint16(this.bb_pos + offset) : 0;
+};
+
+/**
+ * @returns {number}
+ */
+lptc_coderdojo.protocol.DeviceData.prototype.height = function() {
+  var offset = this.bb.__offset(this.bb_pos, 14);
+  return offset ? this.bb.readUint16(this.bb_pos + offset) : 0;
+};
+
+/**
+ * @returns {number}
+ */
+lptc_coderdojo.protocol.DeviceData.prototype.deviceTimestamp = function() {
+  var offset = this.bb.__offset(this.bb_pos, 16);
+  return offset ? this.bb.readUint32(this.bb_pos + offset) : 0;
+};
+
 /**
  * @param {flatbuffers.Builder} builder
  */
 lptc_coderdojo.protocol.DeviceData.startDeviceData = function(builder) {
-  builder.startObject(3);
+  builder.startObject(7);
 };
 
 /**
@@ -194,6 +249,59 @@ lptc_coderdojo.protocol.DeviceData.startVideoVector = function(builder, numElems
   builder.startVector(1, numElems, 1);
 };
 
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {flatbuffers.Offset} depthRawOffset
+ */
+lptc_coderdojo.protocol.DeviceData.addDepthRaw = function(builder, depthRawOffset) {
+  builder.addFieldOffset(3, depthRawOffset, 0);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {Array.<number>} data
+ * @returns {flatbuffers.Offset}
+ */
+lptc_coderdojo.protocol.DeviceData.createDepthRawVector = function(builder, data) {
+  builder.startVector(2, data.length, 2);
+  for (var i = data.length - 1; i >= 0; i--) {
+    builder.addInt16(data[i]);
+  }
+  return builder.endVector();
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {number} numElems
+ */
+lptc_coderdojo.protocol.DeviceData.startDepthRawVector = function(builder, numElems) {
+  builder.startVector(2, numElems, 2);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {number} width
+ */
+lptc_coderdojo.protocol.DeviceData.addWidth = function(builder, width) {
+  builder.addFieldInt16(4, width, 0);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {number} height
+ */
+lptc_coderdojo.protocol.DeviceData.addHeight = function(builder, height) {
+  builder.addFieldInt16(5, height, 0);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {number} deviceTimestamp
+ */
+lptc_coderdojo.protocol.DeviceData.addDeviceTimestamp = function(builder, deviceTimestamp) {
+  builder.addFieldInt32(6, deviceTimestamp, 0);
+};
+
 /**
  * @param {flatbuffers.Builder} builder
  * @returns {flatbuffers.Offset}
@@ -203,6 +311,107 @@ lptc_coderdojo.protocol.DeviceData.endDeviceData = function(builder) {
   return offset;
 };
 
+/**
+ * @constructor
+ */
+lptc_coderdojo.protocol.RgbdData = function() {
+  /**
+   * @type {flatbuffers.ByteBuffer}
+   */
+  this.bb = null;
+
+  /**
+   * @type {number}
+   */
+  this.bb_pos = 0;
+};
+
+/**
+ * @param {number} i
+ * @param {flatbuffers.ByteBuffer} bb
+ * @returns {lptc_coderdojo.protocol.RgbdData}
+ */
+lptc_coderdojo.protocol.RgbdData.prototype.__init = function(i, bb) {
+  this.bb_pos = i;
+  this.bb = bb;
+  return this;
+};
+
+/**
+ * @param {flatbuffers.ByteBuffer} bb
+ * @param {lptc_coderdojo.protocol.RgbdData=} obj
+ * @returns {lptc_coderdojo.protocol.RgbdData}
+ */
+lptc_coderdojo.protocol.RgbdData.getRootAsRgbdData = function(bb, obj) {
+  return (obj || new lptc_coderdojo.protocol.RgbdData).__init(bb.readInt32(bb.position()) + bb.position(), bb);
+};
+
+/**
+ * @param {lptc_coderdojo.protocol.DeviceData=} obj
+ * @returns {lptc_coderdojo.protocol.DeviceData|null}
+ */
+lptc_coderdojo.protocol.RgbdData.prototype.depth = function(obj) {
+  var offset = this.bb.__offset(this.bb_pos, 4);
+  return offset ? (obj || new lptc_coderdojo.protocol.DeviceData).__init(this.bb.__indirect(this.bb_pos + offset), this.bb) : null;
+};
+
+/**
+ * @param {lptc_coderdojo.protocol.DeviceData=} obj
+ * @returns {lptc_coderdojo.protocol.DeviceData|null}
+ */
+lptc_coderdojo.protocol.RgbdData.prototype.video = function(obj) {
+  var offset = this.bb.__offset(this.bb_pos, 6);
+  return offset ? (obj || new lptc_coderdojo.protocol.DeviceData).__init(this.bb.__indirect(this.bb_pos + offset), this.bb) : null;
+};
+
+/**
+ * @returns {number}
+ */
+lptc_coderdojo.protocol.RgbdData.prototype.skew = function() {
+  var offset = this.bb.__offset(this.bb_pos, 8);
+  return offset ? this.bb.readInt32(this.bb_pos + offset) : 0;
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ */
+lptc_coderdojo.protocol.RgbdData.startRgbdData = function(builder) {
+  builder.startObject(3);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {flatbuffers.Offset} depthOffset
+ */
+lptc_coderdojo.protocol.RgbdData.addDepth = function(builder, depthOffset) {
+  builder.addFieldOffset(0, depthOffset, 0);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {flatbuffers.Offset} videoOffset
+ */
+lptc_coderdojo.protocol.RgbdData.addVideo = function(builder, videoOffset) {
+  builder.addFieldOffset(1, videoOffset, 0);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {number} skew
+ */
+lptc_coderdojo.protocol.RgbdData.addSkew = function(builder, skew) {
+  builder.addFieldInt32(2, skew, 0);
+};
+
+/**
+ * @param {flatbuffers.Builder} builder
+ * @returns {flatbuffers.Offset}
+ */
+lptc_coderdojo.protocol.RgbdData.endRgbdData = function(builder) {
+  var offset = builder.endObject();
+  return offset;
+};
+
 /**
  * @constructor
  */
@@ -272,11 +481,20 @@ lptc_coderdojo.protocol.Message.prototype.data = function(obj) {
   return offset ? (obj || new lptc_coderdojo.protocol.DeviceData).__init(this.bb.__indirect(this.bb_pos + offset), this.bb) : null;
 };
 
+/**
+ * @param {lptc_coderdojo.protocol.RgbdData=} obj
+ * @returns {lptc_coderdojo.protocol.RgbdData|null}
+ */
+lptc_coderdojo.protocol.Message.prototype.rgbd = function(obj) {
+  var offset = this.bb.__offset(this.bb_pos, 12);
+  return offset ? (obj || new lptc_coderdojo.protocol.RgbdData).__init(this.bb.__indirect(this.bb_pos + offset), this.bb) : null;
+};
+
 /**
  * @param {flatbuffers.Builder} builder
  */
 lptc_coderdojo.protocol.Message.startMessage = function(builder) {
-  builder.startObject(4);
+  builder.startObject(5);
 };
 
 /**
@@ -311,6 +529,14 @@ lptc_coderdojo.protocol.Message.addData = function(builder, dataOffset) {
   builder.addFieldOffset(3, dataOffset, 0);
 };
 
+/**
+ * @param {flatbuffers.Builder} builder
+ * @param {flatbuffers.Offset} rgbdOffset
+ */
+lptc_coderdojo.protocol.Message.addRgbd = function(builder, rgbdOffset) {
+  builder.addFieldOffset(4, rgbdOffset, 0);
+};
+
 /**
  * @param {flatbuffers.Builder} builder
  * @returns {flatbuffers.Offset}
@@ -0,0 +1,116 @@
+#include "capture_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace lptc_coderdojo {
+
+CaptureReader::CaptureReader(const std::string& _path)
+    : path(_path), data(nullptr), size(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    std::string error = std::strerror(errno);
+    if (fd >= 0) close(fd);
+    throw std::runtime_error("cannot open capture file `" + path +
+                             "`: " + error);
+  }
+
+  size = st.st_size;
+  void* mapped = size >= sizeof(CaptureHeader)
+                     ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                     : MAP_FAILED;
+  close(fd);
+  const CaptureHeader* header = static_cast<const CaptureHeader*>(mapped);
+  if (mapped == MAP_FAILED || header->magic != kCaptureMagic ||
+      header->version != kCaptureVersion || header->segment_size == 0) {
+    if (mapped != MAP_FAILED) munmap(mapped, size);
+    throw std::runtime_error("`" + path + "` is not a capture file");
+  }
+  data = static_cast<const uint8_t*>(mapped);
+  madvise(mapped, size, MADV_SEQUENTIAL);
+
+  if (header->index_offset) {
+    ReadIndex(*header);
+  } else {
+    WalkSegments(*header);
+  }
+}
+
+CaptureReader::~CaptureReader() {
+  munmap(const_cast<uint8_t*>(data), size);
+}
+
+const std::string& CaptureReader::GetPath() const { return path; }
+
+const std::vector<const CaptureRecord*>& CaptureReader::GetRecords() const {
+  return records;
+}
+
+std::vector<int> CaptureReader::GetDevices() const {
+  std::vector<int> devices;
+  for (const CaptureRecord* record : records) devices.push_back(record->device);
+  std::sort(devices.begin(), devices.end());
+  devices.erase(std::unique(devices.begin(), devices.end()), devices.end());
+  return devices;
+}
+
+const uint8_t* CaptureReader::GetPayload(const CaptureRecord* record) {
+  return reinterpret_cast<const uint8_t*>(record + 1);
+}
+
+void CaptureReader::ReadIndex(const CaptureHeader& header) {
+  uint64_t count = header.frame_count;
+  if (header.index_offset > size ||
+      count > (size - header.index_offset) / sizeof(uint64_t)) {
+    throw std::runtime_error("capture file `" + path + "` is truncated");
+  }
+
+  records.reserve(count);
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t offset;
+    std::memcpy(&offset, data + header.index_offset + i * sizeof(offset),
+                sizeof(offset));
+    const CaptureRecord* record = GetRecord(offset, header.index_offset);
+    if (!record) {
+      throw std::runtime_error("capture file `" + path +
+                               "` has a corrupt index");
+    }
+    records.push_back(record);
+  }
+}
+
+void CaptureReader::WalkSegments(const CaptureHeader& header) {
+  for (uint64_t segment = header.data_offset; segment < size;
+       segment += header.segment_size) {
+    uint64_t limit = std::min<uint64_t>(segment + header.segment_size, size);
+    uint64_t offset = segment;
+    while (const CaptureRecord* record = GetRecord(offset, limit)) {
+      records.push_back(record);
+      offset += GetCaptureRecordSize(record->payload_size);
+    }
+  }
+}
+
+const CaptureRecord* CaptureReader::GetRecord(uint64_t offset,
+                                              uint64_t limit) const {
+  if (offset % kCaptureAlignment != 0 || offset > limit ||
+      limit - offset < sizeof(CaptureRecord)) {
+    return nullptr;
+  }
+  const CaptureRecord* record =
+      reinterpret_cast<const CaptureRecord*>(data + offset);
+  if (record->magic != kCaptureRecordMagic ||
+      GetCaptureRecordSize(record->payload_size) > limit - offset) {
+    return nullptr;
+  }
+  return record;
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,99 @@
+#ifndef LPTC_CODERDOJO_CAPTURE_FILE_H_
+#define LPTC_CODERDOJO_CAPTURE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Layout of a capture file, in the byte order of the recording machine:
+//
+//   CaptureHeader.
+//   Segments of header.segment_size bytes from header.data_offset, which
+//     is a whole number of pages. Each holds whole records, a
+//     CaptureRecord followed by its payload, padded to kCaptureAlignment.
+//     The unused tail of a segment is zero. The last segment is cut short
+//     at its last record.
+//   The index: header.frame_count absolute record offsets, each a uint64_t.
+//
+// The index and frame count are written when the recorder closes. A file
+// whose header has no index was not closed cleanly; its records can still
+// be found by walking each segment up to its first zero magic.
+const uint32_t kCaptureMagic = 0x5043544B;  // "KTCP"
+const uint32_t kCaptureVersion = 1;
+const uint32_t kCaptureRecordMagic = 0x4D52464B;  // "KFRM"
+const size_t kCaptureAlignment = 8;
+
+struct CaptureHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t data_offset;
+  uint64_t segment_size;
+  // 0 until the recorder closes.
+  uint64_t index_offset;
+  uint64_t frame_count;
+};
+
+struct CaptureRecord {
+  uint32_t magic;
+  uint32_t payload_size;
+  // A protocol::DataType, which tells the stream and the payload encoding.
+  uint8_t data_type;
+  // Index of the device the frame came from.
+  uint8_t device;
+  // The device's DepthFormat, which gives the units of depth samples.
+  uint8_t format;
+  uint8_t reserved;
+  uint16_t width;
+  uint16_t height;
+  // The device's own clock.
+  uint32_t device_timestamp;
+  uint32_t reserved2;
+  // Server wall clock capture time, in microseconds since the epoch.
+  int64_t capture_time_us;
+};
+
+static_assert(sizeof(CaptureRecord) % kCaptureAlignment == 0,
+              "records must keep payloads aligned");
+
+// Bytes a record with `payload_size` bytes of payload takes in a segment.
+inline size_t GetCaptureRecordSize(size_t payload_size) {
+  size_t size = sizeof(CaptureRecord) + payload_size;
+  return (size + kCaptureAlignment - 1) / kCaptureAlignment *
+         kCaptureAlignment;
+}
+
+// Maps a capture file read-only and lists its records in file order, from
+// the index when the file was closed cleanly and by walking the segments
+// otherwise. Payloads are read in place from the mapping.
+class CaptureReader {
+ public:
+  // Throws std::runtime_error when the file cannot be mapped or is not a
+  // capture file.
+  explicit CaptureReader(const std::string& path);
+  ~CaptureReader();
+
+  const std::string& GetPath() const;
+  const std::vector<const CaptureRecord*>& GetRecords() const;
+  // Indices of the devices with records, in increasing order.
+  std::vector<int> GetDevices() const;
+
+  static const uint8_t* GetPayload(const CaptureRecord* record);
+
+ private:
+  void ReadIndex(const CaptureHeader& header);
+  void WalkSegments(const CaptureHeader& header);
+  // Returns the record at `offset` when it lies whole within `limit`.
+  const CaptureRecord* GetRecord(uint64_t offset, uint64_t limit) const;
+
+  const std::string path;
+  const uint8_t* data;
+  size_t size;
+  std::vector<const CaptureRecord*> records;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_CAPTURE_FILE_H_
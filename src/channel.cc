@@ -1,40 +1,248 @@
 #include "channel.h"
 
-namespace lptc_coderdojo {
+#include <algorithm>
 
-Channel::Channel(const std::string& t, AsioServer& s) : topic(t), server(s) {}
-Channel::Channel(const Channel& ch) : topic(ch.topic), server(ch.server) {
-  std::lock_guard<std::mutex> guard(subscribers_lock);
-  subscribers = ch.subscribers;
+namespace {
+
+lptc_coderdojo::AsioServer::message_ptr PrepareMessage(
+    websocketpp::frame::opcode::value opcode, void const* data, size_t len) {
+  lptc_coderdojo::AsioServer::message_ptr msg =
+      websocketpp::lib::make_shared<lptc_coderdojo::AsioMessage>(
+          lptc_coderdojo::AsioMessage::con_msg_man_ptr(), opcode, len);
+
+  // Server frames are never masked, so the framing header is the same for
+  // every connection and can be written once here.
+  websocketpp::frame::basic_header header(opcode, len, true, false);
+  websocketpp::frame::extended_header ext_header(len);
+  msg->set_header(websocketpp::frame::prepare_header(header, ext_header));
+  msg->set_payload(data, len);
+  msg->set_prepared(true);
+  return msg;
 }
 
+template <typename List>
+auto FindSubscription(List& list, websocketpp::connection_hdl hdl)
+    -> decltype(list.begin()) {
+  std::owner_less<websocketpp::connection_hdl> less;
+  return std::find_if(list.begin(), list.end(),
+                      [&](const typename List::value_type& sub) {
+                        return !sub->sink && !less(sub->hdl, hdl) &&
+                               !less(hdl, sub->hdl);
+                      });
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+Channel::Subscription::Subscription(websocketpp::connection_hdl h,
+                                    const StreamVariant& v,
+                                    std::shared_ptr<ChannelSink> s)
+    : hdl(h),
+      sink(std::move(s)),
+      variant(v),
+      delivered_frames(0),
+      skipped_frames(0),
+      behind(false) {}
+
+Channel::Channel(const std::string& t, AsioServer& s, const EncodingList& e,
+                 size_t hwm)
+    : topic(t),
+      encodings(e),
+      high_water_mark(hwm),
+      subscribers(std::make_shared<const SubscriptionList>()),
+      metrics(std::make_shared<PipelineMetrics>()),
+      closed(false),
+      server(s) {}
+Channel::Channel(const Channel& ch)
+    : topic(ch.topic),
+      encodings(ch.encodings),
+      high_water_mark(ch.high_water_mark),
+      subscribers(ch.LoadSubscribers()),
+      metrics(ch.metrics),
+      closed(ch.closed),
+      server(ch.server) {}
+
 const std::string& Channel::GetTopic() const { return topic; }
 
-void Channel::Publish(void const* data, size_t len) {
-  std::lock_guard<std::mutex> guard(subscribers_lock);
+size_t Channel::GetHighWaterMark() const { return high_water_mark; }
+
+std::vector<SubscriberStats> Channel::GetSubscriberStats() {
+  SubscriptionSnapshot snapshot = LoadSubscribers();
+  std::vector<SubscriberStats> stats;
+
+  for (const std::shared_ptr<Subscription>& sub : *snapshot) {
+    if (sub->sink) continue;
+    SubscriberStats entry;
+    entry.hdl = sub->hdl;
+    entry.variant = sub->variant;
+    entry.delivered_frames = sub->delivered_frames.load();
+    entry.skipped_frames = sub->skipped_frames.load();
+    entry.buffered_bytes = 0;
+
+    websocketpp::lib::error_code ec;
+    AsioServer::connection_ptr conn = server.get_con_from_hdl(sub->hdl, ec);
+    if (!ec) entry.buffered_bytes = conn->get_buffered_amount();
+    stats.push_back(entry);
+  }
+  return stats;
+}
+
+size_t Channel::GetSubscriberCount() { return LoadSubscribers()->size(); }
+
+lptc_coderdojo::PipelineMetrics& Channel::GetMetrics() { return *metrics; }
+
+bool Channel::SupportsEncoding(Encoding encoding) const {
+  return std::find(encodings.begin(), encodings.end(), encoding) !=
+         encodings.end();
+}
+
+bool Channel::HasSubscribers() { return !LoadSubscribers()->empty(); }
+
+bool Channel::WaitForSubscribers() {
+  std::unique_lock<std::mutex> lock(subscribers_lock);
+  demand_cond.wait(lock,
+                   [this] { return closed || !LoadSubscribers()->empty(); });
+  return !closed;
+}
+
+bool Channel::WaitForClose(const std::chrono::milliseconds& timeout) {
+  std::unique_lock<std::mutex> lock(subscribers_lock);
+  return demand_cond.wait_for(lock, timeout, [this] { return closed; });
+}
+
+void Channel::Close() {
+  {
+    std::lock_guard<std::mutex> guard(subscribers_lock);
+    closed = true;
+  }
+  demand_cond.notify_all();
+}
 
-  if (subscribers.empty()) {
+void Channel::GetActiveVariants(VariantList& active) {
+  SubscriptionSnapshot snapshot = LoadSubscribers();
+  active.clear();
+
+  for (const std::shared_ptr<Subscription>& sub : *snapshot) {
+    if (std::find(active.begin(), active.end(), sub->variant) == active.end())
+      active.push_back(sub->variant);
+  }
+}
+
+void Channel::Publish(const StreamVariant& variant, void const* data,
+                      size_t len, websocketpp::frame::opcode::value opcode) {
+  SubscriptionSnapshot snapshot = LoadSubscribers();
+
+  if (snapshot->empty()) {
     return;
   }
 
-  ConnectionSet::iterator iter;
-  for (iter = subscribers.begin(); iter != subscribers.end(); ++iter) {
-    try {
-      server.send(*iter, data, len, websocketpp::frame::opcode::binary);
-    } catch (websocketpp::exception const& e) {
-      std::cerr << "!!!Error: " << e.m_msg << std::endl;
+  StageTimer timer(*metrics);
+  AsioServer::message_ptr msg;
+
+  for (const std::shared_ptr<Subscription>& sub : *snapshot) {
+    if (sub->variant != variant) continue;
+    if (sub->sink) {
+      sub->sink->Consume(variant, data, len);
+      sub->delivered_frames++;
+      continue;
     }
+
+    websocketpp::lib::error_code ec;
+    AsioServer::connection_ptr conn = server.get_con_from_hdl(sub->hdl, ec);
+    if (ec) continue;
+
+    if (conn->get_buffered_amount() > high_water_mark) {
+      if (!sub->behind.exchange(true)) {
+        std::cerr << "!!!Warning: skipping `" << topic
+                  << "` frames for slow subscriber "
+                  << conn->get_remote_endpoint() << std::endl;
+      }
+      sub->skipped_frames++;
+      metrics->AddSkippedFrame();
+      continue;
+    }
+
+    if (!msg) msg = PrepareMessage(opcode, data, len);
+    ec = conn->send(msg);
+    if (ec) {
+      metrics->AddSendError();
+      std::cerr << "!!!Error: " << ec.message() << std::endl;
+      continue;
+    }
+    sub->behind = false;
+    sub->delivered_frames++;
+    metrics->AddSentFrame(len);
   }
+  timer.Lap(PipelineStage::FAN_OUT);
 }
 
-void Channel::Subscribe(websocketpp::connection_hdl hdl) {
+void Channel::Subscribe(websocketpp::connection_hdl hdl,
+                        const StreamVariant& variant) {
   std::lock_guard<std::mutex> guard(subscribers_lock);
-  subscribers.insert(hdl);
+
+  std::shared_ptr<SubscriptionList> updated =
+      std::make_shared<SubscriptionList>(*LoadSubscribers());
+  std::shared_ptr<Subscription> sub =
+      std::make_shared<Subscription>(hdl, variant);
+
+  SubscriptionList::iterator search = FindSubscription(*updated, hdl);
+  if (search != updated->end()) {
+    // Changing the variant replaces the subscription but keeps its counts.
+    sub->delivered_frames = (*search)->delivered_frames.load();
+    sub->skipped_frames = (*search)->skipped_frames.load();
+    *search = sub;
+  } else {
+    updated->push_back(sub);
+  }
+
+  StoreSubscribers(updated);
 }
 
 void Channel::Unsubscribe(websocketpp::connection_hdl hdl) {
   std::lock_guard<std::mutex> guard(subscribers_lock);
-  subscribers.erase(hdl);
+
+  SubscriptionSnapshot current = LoadSubscribers();
+  if (FindSubscription(*current, hdl) == current->end()) return;
+
+  std::shared_ptr<SubscriptionList> updated =
+      std::make_shared<SubscriptionList>(*current);
+  updated->erase(FindSubscription(*updated, hdl));
+  StoreSubscribers(updated);
+}
+
+void Channel::AttachSink(std::shared_ptr<ChannelSink> sink,
+                         const StreamVariant& variant) {
+  std::lock_guard<std::mutex> guard(subscribers_lock);
+
+  std::shared_ptr<SubscriptionList> updated =
+      std::make_shared<SubscriptionList>(*LoadSubscribers());
+  updated->push_back(std::make_shared<Subscription>(
+      websocketpp::connection_hdl(), variant, std::move(sink)));
+  StoreSubscribers(updated);
+}
+
+void Channel::DetachSink(const std::shared_ptr<ChannelSink>& sink) {
+  std::lock_guard<std::mutex> guard(subscribers_lock);
+
+  std::shared_ptr<SubscriptionList> updated =
+      std::make_shared<SubscriptionList>(*LoadSubscribers());
+  updated->erase(std::remove_if(updated->begin(), updated->end(),
+                                [&](const std::shared_ptr<Subscription>& sub) {
+                                  return sub->sink == sink;
+                                }),
+                 updated->end());
+  StoreSubscribers(updated);
+}
+
+Channel::SubscriptionSnapshot Channel::LoadSubscribers() const {
+  return std::atomic_load(&subscribers);
+}
+
+// Called with subscribers_lock held.
+void Channel::StoreSubscribers(SubscriptionSnapshot updated) {
+  std::atomic_store(&subscribers, updated);
+  demand_cond.notify_all();
 }
 
-}  // namespace lptc_coderdojo
\ No newline at end of file
+}  // namespace lptc_coderdojo
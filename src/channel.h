@@ -1,34 +1,136 @@
 #ifndef LPTC_CODERDOJO_CHANNEL_H_
 #define LPTC_CODERDOJO_CHANNEL_H_
 
+#include "encoding.h"
+#include "metrics.h"
+#include "stream_variant.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <memory>
 #include <set>
+#include <vector>
 
 #include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/frame.hpp>
 #include <websocketpp/server.hpp>
 
 namespace lptc_coderdojo {
 
 typedef websocketpp::server<websocketpp::config::asio> AsioServer;
+typedef websocketpp::config::asio::message_type AsioMessage;
 typedef std::set<websocketpp::connection_hdl,
                  std::owner_less<websocketpp::connection_hdl>>
     ConnectionSet;
 
+// Bytes a subscriber may have queued on its connection before the channel
+// starts skipping frames for it.
+const size_t kDefaultSendHighWaterMark = 4 * 1024 * 1024;
+
+typedef std::vector<Encoding> EncodingList;
+typedef std::vector<StreamVariant> VariantList;
+
+// Receives a channel's frames in-process, like a websocket subscriber but
+// without a connection. Consume runs on the publishing thread for every frame
+// of the sink's variant, so it must return quickly and never block.
+class ChannelSink {
+ public:
+  virtual ~ChannelSink() = default;
+
+  virtual void Consume(const StreamVariant& variant, void const* data,
+                       size_t len) = 0;
+};
+
+struct SubscriberStats {
+  websocketpp::connection_hdl hdl;
+  StreamVariant variant;
+  size_t delivered_frames;
+  size_t skipped_frames;
+  size_t buffered_bytes;
+};
+
 class Channel {
  public:
-  Channel(const std::string& t, AsioServer& s);
+  Channel(const std::string& t, AsioServer& s, const EncodingList& e,
+          size_t hwm = kDefaultSendHighWaterMark);
   Channel(const Channel& ch);
 
   const std::string& GetTopic() const;
+  size_t GetHighWaterMark() const;
+  std::vector<SubscriberStats> GetSubscriberStats();
+  // Counts sinks along with websocket subscribers.
+  size_t GetSubscriberCount();
+  // Shared by every copy of the channel. Publish records the fan-out time
+  // and traffic; publishers record the stages before it.
+  lptc_coderdojo::PipelineMetrics& GetMetrics();
+  bool SupportsEncoding(Encoding encoding) const;
+
+  // Lets publishers leave the device idle while nobody is watching.
+  // WaitForSubscribers blocks until the channel has a subscriber and returns
+  // false once the channel has been closed. WaitForClose blocks for at most
+  // `timeout` and returns true once the channel has been closed.
+  bool HasSubscribers();
+  bool WaitForSubscribers();
+  bool WaitForClose(const std::chrono::milliseconds& timeout);
+  void Close();
+
+  // Fills `active` with every variant at least one subscriber asked for, so
+  // publishers only produce each of them once per frame.
+  void GetActiveVariants(VariantList& active);
 
-  void Publish(void const* data, size_t len);
-  void Subscribe(websocketpp::connection_hdl hdl);
+  // Frames the data once and queues the same message on the connection of
+  // every subscriber that asked for `variant`, so the fan-out cost does not
+  // grow with the payload size. Subscribers with more than the high-water
+  // mark still buffered are skipped, so a slow client only ever falls behind
+  // by dropping frames. Takes no lock: it walks the current subscriber
+  // snapshot, so Subscribe and Unsubscribe never wait for a broadcast.
+  // Send errors are counted in the channel's metrics.
+  void Publish(const StreamVariant& variant, void const* data, size_t len,
+               websocketpp::frame::opcode::value opcode =
+                   websocketpp::frame::opcode::binary);
+  void Subscribe(websocketpp::connection_hdl hdl,
+                 const StreamVariant& variant = StreamVariant());
   void Unsubscribe(websocketpp::connection_hdl hdl);
+  // Sinks count as subscribers, so they keep the publisher running and get
+  // their variant produced.
+  void AttachSink(std::shared_ptr<ChannelSink> sink,
+                  const StreamVariant& variant);
+  void DetachSink(const std::shared_ptr<ChannelSink>& sink);
 
  private:
+  // Counters are atomic because broadcasts update them through snapshots
+  // that a concurrent Subscribe may already have replaced.
+  struct Subscription {
+    Subscription(websocketpp::connection_hdl h, const StreamVariant& v,
+                 std::shared_ptr<ChannelSink> s = nullptr);
+
+    const websocketpp::connection_hdl hdl;
+    // Set for sinks, which have no connection.
+    const std::shared_ptr<ChannelSink> sink;
+    const StreamVariant variant;
+    std::atomic<size_t> delivered_frames;
+    std::atomic<size_t> skipped_frames;
+    std::atomic<bool> behind;
+  };
+  // Never modified once published. Writers copy the current list, change
+  // the copy and swap it in, so readers only pay for an atomic load.
+  typedef std::vector<std::shared_ptr<Subscription>> SubscriptionList;
+  typedef std::shared_ptr<const SubscriptionList> SubscriptionSnapshot;
+
+  SubscriptionSnapshot LoadSubscribers() const;
+  void StoreSubscribers(SubscriptionSnapshot updated);
+
   std::string topic;
-  ConnectionSet subscribers;
+  EncodingList encodings;
+  size_t high_water_mark;
+  SubscriptionSnapshot subscribers;
+  std::shared_ptr<lptc_coderdojo::PipelineMetrics> metrics;
+  bool closed;
+  // Serializes writers of `subscribers` and guards `closed`.
   std::mutex subscribers_lock;
+  std::condition_variable demand_cond;
   AsioServer& server;
 };
 
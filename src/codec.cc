@@ -0,0 +1,278 @@
+#include "codec.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <iostream>
+
+#include <jpeglib.h>
+
+namespace {
+
+class NibbleWriter {
+ public:
+  explicit NibbleWriter(uint8_t* _out)
+      : out(_out), begin(_out), word(0), nibbles(0) {}
+
+  void WriteVle(uint32_t value) {
+    do {
+      uint32_t nibble = value & 0x7;
+      value >>= 3;
+      if (value) nibble |= 0x8;
+      word = (word << 4) | nibble;
+      if (++nibbles == 8) Flush();
+    } while (value);
+  }
+
+  size_t Finish() {
+    if (nibbles) {
+      word <<= 4 * (8 - nibbles);
+      Flush();
+    }
+    return out - begin;
+  }
+
+ private:
+  void Flush() {
+    out[0] = (uint8_t)word;
+    out[1] = (uint8_t)(word >> 8);
+    out[2] = (uint8_t)(word >> 16);
+    out[3] = (uint8_t)(word >> 24);
+    out += 4;
+    word = 0;
+    nibbles = 0;
+  }
+
+  uint8_t* out;
+  uint8_t* begin;
+  uint32_t word;
+  int nibbles;
+};
+
+class NibbleReader {
+ public:
+  NibbleReader(const uint8_t* _in, size_t len)
+      : in(_in), end(_in + len - len % 4), word(0), nibbles(0) {}
+
+  bool ReadVle(uint32_t* value) {
+    uint32_t result = 0;
+    int shift = 0;
+    uint32_t nibble;
+    do {
+      if (nibbles == 0) {
+        if (in == end) return false;
+        word = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+        in += 4;
+        nibbles = 8;
+      }
+      nibble = word >> 28;
+      word <<= 4;
+      nibbles--;
+      // No valid value needs more than 11 nibbles of 3 bits.
+      if (shift > 30) return false;
+      result |= (nibble & 0x7) << shift;
+      shift += 3;
+    } while (nibble & 0x8);
+
+    *value = result;
+    return true;
+  }
+
+ private:
+  const uint8_t* in;
+  const uint8_t* end;
+  uint32_t word;
+  int nibbles;
+};
+
+// Frames are rarely larger than this fraction of their raw size even at
+// high quality; the buffer grows past it when needed.
+const size_t kJpegInitialSizeDivisor = 4;
+
+// libjpeg destination writing into a std::vector that is kept across
+// frames.
+struct VectorDestination {
+  jpeg_destination_mgr mgr;
+  std::vector<uint8_t>* out;
+};
+
+void InitDestination(j_compress_ptr cinfo) {
+  VectorDestination* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+  dest->out->resize(dest->out->capacity());
+  dest->mgr.next_output_byte = dest->out->data();
+  dest->mgr.free_in_buffer = dest->out->size();
+}
+
+boolean EmptyOutputBuffer(j_compress_ptr cinfo) {
+  VectorDestination* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+  size_t used = dest->out->size();
+  dest->out->resize(used * 2);
+  dest->mgr.next_output_byte = dest->out->data() + used;
+  dest->mgr.free_in_buffer = dest->out->size() - used;
+  return TRUE;
+}
+
+void TermDestination(j_compress_ptr cinfo) {
+  VectorDestination* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+  dest->out->resize(dest->out->size() - dest->mgr.free_in_buffer);
+}
+
+struct JpegError {
+  jpeg_error_mgr mgr;
+  std::jmp_buf jump;
+};
+
+// libjpeg's default handler exits the process.
+void ExitWithJump(j_common_ptr cinfo) {
+  JpegError* error = reinterpret_cast<JpegError*>(cinfo->err);
+  char message[JMSG_LENGTH_MAX];
+  (*cinfo->err->format_message)(cinfo, message);
+  std::cerr << "!!!Error: JPEG codec failed: " << message << std::endl;
+  std::longjmp(error->jump, 1);
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+struct JpegEncoder::State {
+  jpeg_compress_struct cinfo;
+  JpegError error;
+  VectorDestination dest;
+};
+
+JpegEncoder::JpegEncoder() : state(new State()) {
+  state->cinfo.err = jpeg_std_error(&state->error.mgr);
+  state->error.mgr.error_exit = ExitWithJump;
+  jpeg_create_compress(&state->cinfo);
+
+  state->dest.mgr.init_destination = InitDestination;
+  state->dest.mgr.empty_output_buffer = EmptyOutputBuffer;
+  state->dest.mgr.term_destination = TermDestination;
+  state->cinfo.dest = &state->dest.mgr;
+}
+
+JpegEncoder::~JpegEncoder() { jpeg_destroy_compress(&state->cinfo); }
+
+bool JpegEncoder::Encode(const uint8_t* pixels, int width, int height,
+                         int channels, int quality,
+                         std::vector<uint8_t>* out) {
+  jpeg_compress_struct& cinfo = state->cinfo;
+  size_t row_size = (size_t)width * channels;
+  if (out->capacity() == 0)
+    out->reserve(row_size * height / kJpegInitialSizeDivisor + 1024);
+  state->dest.out = out;
+
+  if (setjmp(state->error.jump)) {
+    jpeg_abort_compress(&cinfo);
+    return false;
+  }
+
+  cinfo.image_width = width;
+  cinfo.image_height = height;
+  cinfo.input_components = channels;
+  cinfo.in_color_space = channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW row =
+        const_cast<JSAMPROW>(pixels + cinfo.next_scanline * row_size);
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  return true;
+}
+
+struct JpegDecoder::State {
+  jpeg_decompress_struct cinfo;
+  JpegError error;
+};
+
+JpegDecoder::JpegDecoder() : state(new State()) {
+  state->cinfo.err = jpeg_std_error(&state->error.mgr);
+  state->error.mgr.error_exit = ExitWithJump;
+  jpeg_create_decompress(&state->cinfo);
+}
+
+JpegDecoder::~JpegDecoder() { jpeg_destroy_decompress(&state->cinfo); }
+
+bool JpegDecoder::Decode(const uint8_t* jpeg, size_t len, int width,
+                         int height, uint8_t* rgb) {
+  jpeg_decompress_struct& cinfo = state->cinfo;
+  size_t row_size = (size_t)width * 3;
+
+  if (setjmp(state->error.jump)) {
+    jpeg_abort_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_mem_src(&cinfo, const_cast<uint8_t*>(jpeg), len);
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+  if ((int)cinfo.output_width != width || (int)cinfo.output_height != height) {
+    jpeg_abort_decompress(&cinfo);
+    return false;
+  }
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row = rgb + cinfo.output_scanline * row_size;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  return true;
+}
+
+// A zigzag encoded 16-bit delta needs at most 17 bits, 6 nibbles. A zero
+// sample costs at most the two run length nibbles it starts, so the worst
+// case is every sample non-zero, plus the two leading run lengths.
+size_t GetRvlMaxSize(size_t pixels) { return (pixels * 3 + 8) / 4 * 4 + 8; }
+
+size_t EncodeRvl(const uint16_t* depth, size_t pixels, uint8_t* out) {
+  NibbleWriter writer(out);
+  const uint16_t* end = depth + pixels;
+  int32_t previous = 0;
+
+  while (depth != end) {
+    uint32_t zeros = 0;
+    for (; depth != end && (*depth ^ kRvlSampleKey) == 0; depth++) zeros++;
+    writer.WriteVle(zeros);
+
+    uint32_t nonzeros = 0;
+    for (const uint16_t* p = depth; p != end && (*p ^ kRvlSampleKey) != 0; p++)
+      nonzeros++;
+    writer.WriteVle(nonzeros);
+
+    for (uint32_t i = 0; i < nonzeros; i++) {
+      int32_t current = *depth++ ^ kRvlSampleKey;
+      int32_t delta = current - previous;
+      writer.WriteVle(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+      previous = current;
+    }
+  }
+  return writer.Finish();
+}
+
+bool DecodeRvl(const uint8_t* in, size_t len, uint16_t* depth, size_t pixels) {
+  NibbleReader reader(in, len);
+  uint16_t* end = depth + pixels;
+  int32_t previous = 0;
+
+  while (depth != end) {
+    uint32_t zeros, nonzeros;
+    if (!reader.ReadVle(&zeros) || zeros > (size_t)(end - depth)) return false;
+    for (uint32_t i = 0; i < zeros; i++) *depth++ = kRvlSampleKey;
+
+    if (!reader.ReadVle(&nonzeros) || nonzeros > (size_t)(end - depth))
+      return false;
+    for (uint32_t i = 0; i < nonzeros; i++) {
+      uint32_t positive;
+      if (!reader.ReadVle(&positive)) return false;
+      int32_t delta = (int32_t)(positive >> 1) ^ -(int32_t)(positive & 1);
+      previous += delta;
+      *depth++ = (uint16_t)previous ^ kRvlSampleKey;
+    }
+  }
+  return true;
+}
+
+}  // namespace lptc_coderdojo
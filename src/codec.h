@@ -0,0 +1,72 @@
+#ifndef LPTC_CODERDOJO_CODEC_H_
+#define LPTC_CODERDOJO_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Lossless depth coding in the style of RVL (A. Wilson, "Fast Lossless Depth
+// Image Compression", 2017): the frame alternates runs of zero samples and
+// runs of non-zero samples, each run prefixed by its length, and non-zero
+// samples are stored as the zigzag encoded delta from the previous non-zero
+// sample. Every value is written as a variable-length chain of 4-bit
+// nibbles, 3 value bits plus a continuation bit, most significant nibble
+// first in little-endian 32-bit words.
+//
+// The Kinect reports "no reading" as 2047 rather than 0, so samples are
+// XORed with kRvlSampleKey first. This maps no reading to zero and keeps
+// deltas between valid samples the same size, and is its own inverse.
+const uint16_t kRvlSampleKey = 0x7FF;
+
+// Largest encoding of `pixels` samples, in bytes.
+size_t GetRvlMaxSize(size_t pixels);
+// Encodes `pixels` samples into `out`, which must hold GetRvlMaxSize(pixels)
+// bytes. Returns the encoded size, always a multiple of 4.
+size_t EncodeRvl(const uint16_t* depth, size_t pixels, uint8_t* out);
+// Decodes exactly `pixels` samples. Returns false when `in` is truncated or
+// describes more samples than that.
+bool DecodeRvl(const uint8_t* in, size_t len, uint16_t* depth, size_t pixels);
+
+// Baseline JPEG compression of RGB or greyscale frames through libjpeg.
+// Keeps one compressor and grows `out` only when a frame needs more room
+// than any before it, so steady state encoding does not allocate. Not
+// thread-safe; use one encoder per thread.
+class JpegEncoder {
+ public:
+  JpegEncoder();
+  ~JpegEncoder();
+
+  // Replaces the contents of `out` with the JPEG image of `pixels`, which
+  // holds `channels` samples per pixel: 3 for RGB, 1 for greyscale. Returns
+  // false, with `out` unspecified, when libjpeg reports an error.
+  bool Encode(const uint8_t* pixels, int width, int height, int channels,
+              int quality, std::vector<uint8_t>* out);
+
+ private:
+  struct State;
+  std::unique_ptr<State> state;
+};
+
+// Decompresses JPEG images to RGB through libjpeg, reusing one decompressor.
+// Not thread-safe; use one decoder per thread.
+class JpegDecoder {
+ public:
+  JpegDecoder();
+  ~JpegDecoder();
+
+  // Writes the image as RGB to `rgb`, which holds width * height * 3 bytes.
+  // Returns false when the image is corrupt or not `width` by `height`.
+  bool Decode(const uint8_t* jpeg, size_t len, int width, int height,
+              uint8_t* rgb);
+
+ private:
+  struct State;
+  std::unique_ptr<State> state;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_CODEC_H_
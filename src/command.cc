@@ -6,9 +6,20 @@ namespace lptc_coderdojo {
 
 Command::Command(Action a) : action(a) {}
 Command::Command(Action a, const std::string t) : action(a), topic(t) {}
+Command::Command(Action a, const std::string t, const Params p)
+    : action(a), topic(t), params(p) {}
 
 const Command::Action& Command::GetAction() const { return action; }
 const std::string& Command::GetTopic() const { return topic; }
+const Command::Params& Command::GetParams() const { return params; }
+
+std::string Command::GetParam(const std::string& key,
+                              const std::string& default_value) const {
+  Params::const_iterator search = params.find(key);
+  if (search != params.end()) return search->second;
+
+  return default_value;
+}
 
 std::string Command::ActionStr(Action a) {
   switch (a) {
@@ -44,13 +55,29 @@ std::vector<std::string> Command::GetTokensFromPayload(
   return tokens;
 }
 
+bool Command::ParamFromToken(const std::string& token, Params& params) {
+  size_t separator = token.find('=');
+  if (separator == std::string::npos || separator == 0 ||
+      separator == token.length() - 1)
+    return false;
+
+  return params
+      .insert(Params::value_type(token.substr(0, separator),
+                                 token.substr(separator + 1)))
+      .second;
+}
+
 Command Command::FromMessagePayload(const std::string& msg) {
   std::vector<std::string> tokens = GetTokensFromPayload(msg);
 
-  if (tokens.size() != 2 || tokens[0].length() == 0 || tokens[1].length() == 0)
+  if (tokens.size() < 2 || tokens[0].length() == 0 || tokens[1].length() == 0)
     return Command(Action::INVALID);
 
-  return Command(ActionFromToken(tokens[0]), tokens[1]);
+  Params params;
+  for (size_t i = 2; i < tokens.size(); i++)
+    if (!ParamFromToken(tokens[i], params)) return Command(Action::INVALID);
+
+  return Command(ActionFromToken(tokens[0]), tokens[1], params);
 }
 
 }  // namespace lptc_coderdojo
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define LPTC_CODERDOJO_COMMAND_H_
 
 #include <iostream>
+#include <map>
 #include <vector>
 
 namespace lptc_coderdojo {
@@ -9,22 +10,30 @@ namespace lptc_coderdojo {
 class Command {
  public:
   enum Action { SUBSCRIBE, UNSUBSCRIBE, INVALID };
+  typedef std::map<std::string, std::string> Params;
 
   Command(Action a);
   Command(Action a, const std::string t);
+  Command(Action a, const std::string t, const Params p);
 
   const Action& GetAction() const;
   const std::string& GetTopic() const;
+  const Params& GetParams() const;
+  std::string GetParam(const std::string& key,
+                       const std::string& default_value) const;
 
   static std::string ActionStr(Action a);
   static Action ActionFromToken(const std::string& token);
   static std::vector<std::string> GetTokensFromPayload(
       const std::string& msg_payload);
+  static bool ParamFromToken(const std::string& token, Params& params);
+  // Parses `<ACTION> <topic> [key=value ...]`.
   static Command FromMessagePayload(const std::string& msg);
 
  private:
   Action action;
   std::string topic;
+  Params params;
 };
 
 }  // namespace lptc_coderdojo
@@ -0,0 +1,467 @@
+#include "config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const int kDefaultPort = 9002;
+const int kMaxDeviceIndex = 15;
+const int kMaxThreads = 64;
+// Under half the 33 ms frame interval, so no frame has two candidates.
+const int kDefaultSyncToleranceMs = 10;
+const int kMaxSyncToleranceMs = 100;
+const int kMaxReplayLoops = 1000000;
+const int kDefaultLoadClients = 10;
+const int kMaxLoadClients = 10000;
+const int kDefaultWarmupS = 2;
+const int kDefaultDurationS = 10;
+const int kMaxLoadSeconds = 24 * 3600;
+
+bool ParseThreadsValue(const std::string& value, size_t* result) {
+  int threads;
+  if (!lptc_coderdojo::ParseIntValue(value, 0, kMaxThreads, &threads))
+    return false;
+
+  *result = threads;
+  return true;
+}
+
+// Parses "all" or a comma separated list of device indices.
+bool ParseDevicesValue(const std::string& value, std::vector<int>* result) {
+  std::vector<int> indices;
+  if (value != "all") {
+    std::istringstream iss(value);
+    std::string field;
+    int index;
+
+    if (value.empty() || value[value.size() - 1] == ',') return false;
+    while (std::getline(iss, field, ',')) {
+      if (!lptc_coderdojo::ParseIntValue(field, 0, kMaxDeviceIndex, &index))
+        return false;
+      indices.push_back(index);
+    }
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+  }
+
+  result->swap(indices);
+  return true;
+}
+
+bool ParseSecondsValue(const std::string& value, int min,
+                       std::chrono::seconds* result) {
+  int seconds;
+  if (!lptc_coderdojo::ParseIntValue(value, min, kMaxLoadSeconds, &seconds))
+    return false;
+
+  *result = std::chrono::seconds(seconds);
+  return true;
+}
+
+// Parses a comma separated list of channel topics.
+bool ParseTopicsValue(const std::string& value,
+                      std::vector<std::string>* result) {
+  std::vector<std::string> topics;
+  std::istringstream iss(value);
+  std::string topic;
+
+  if (value.empty() || value[value.size() - 1] == ',') return false;
+  while (std::getline(iss, topic, ',')) {
+    if (topic.empty()) return false;
+    topics.push_back(topic);
+  }
+
+  result->swap(topics);
+  return true;
+}
+
+bool ParseConfigFile(const std::string& path,
+                     lptc_coderdojo::ServerConfig* config, std::string* error);
+
+// Applies one `key=value` setting. `from_file` forbids nesting config files.
+bool ApplySetting(const std::string& setting, bool from_file,
+                  lptc_coderdojo::ServerConfig* config, std::string* error) {
+  size_t pos = setting.find('=');
+  std::string key = setting.substr(0, pos);
+  std::string value =
+      pos == std::string::npos ? std::string() : setting.substr(pos + 1);
+  bool valid;
+
+  if (!from_file && key == "help" && pos == std::string::npos) {
+    config->show_help = true;
+    return true;
+  }
+  if (pos == std::string::npos) {
+    *error = "expected key=value, got `" + setting + "`";
+    return false;
+  }
+
+  if (key == "port") {
+    valid = lptc_coderdojo::ParseIntValue(value, 1, 65535, &config->port);
+  } else if (key == "source") {
+    valid = lptc_coderdojo::DeviceSourceFromName(value, &config->source);
+  } else if (key == "devices") {
+    valid = ParseDevicesValue(value, &config->device_indices);
+  } else if (key == "video-resolution") {
+    valid = lptc_coderdojo::ResolutionFromName(
+        value, &config->device.video_resolution);
+  } else if (key == "video-format") {
+    valid = lptc_coderdojo::VideoFormatFromName(value,
+                                                &config->device.video_format);
+  } else if (key == "depth-format") {
+    valid = lptc_coderdojo::DepthFormatFromName(value,
+                                                &config->device.depth_format);
+  } else if (key == "max-fps") {
+    valid = lptc_coderdojo::ParseIntValue(value, 0, lptc_coderdojo::kMaxFps,
+                                          &config->device.max_fps);
+  } else if (key == "sync-tolerance-ms") {
+    int ms;
+    valid = lptc_coderdojo::ParseIntValue(value, 0, kMaxSyncToleranceMs, &ms);
+    if (valid) config->device.sync_tolerance = std::chrono::milliseconds(ms);
+  } else if (key == "io-threads") {
+    valid = ParseThreadsValue(value, &config->io_threads);
+  } else if (key == "transform-threads") {
+    valid = ParseThreadsValue(value, &config->transform_threads);
+  } else if (key == "record") {
+    config->record_path = value;
+    valid = !value.empty();
+  } else if (key == "record-depth") {
+    valid = lptc_coderdojo::EncodingFromName(value,
+                                             &config->record_depth_encoding);
+  } else if (key == "record-video") {
+    valid = lptc_coderdojo::EncodingFromName(value,
+                                             &config->record_video_encoding);
+  } else if (key == "replay") {
+    config->replay.path = value;
+    valid = !value.empty();
+  } else if (key == "replay-mode") {
+    valid = lptc_coderdojo::ReplayModeFromName(value, &config->replay.mode);
+  } else if (key == "replay-loops") {
+    valid = lptc_coderdojo::ParseIntValue(value, 0, kMaxReplayLoops,
+                                          &config->replay.loops);
+  } else if (key == "config" && !from_file) {
+    return ParseConfigFile(value, config, error);
+  } else {
+    *error = "unknown setting `" + key + "`";
+    return false;
+  }
+
+  if (!valid) *error = "invalid value `" + value + "` for `" + key + "`";
+  return valid;
+}
+
+bool ParseConfigFile(const std::string& path,
+                     lptc_coderdojo::ServerConfig* config,
+                     std::string* error) {
+  std::ifstream file(path);
+  if (!file) {
+    *error = "cannot read config file `" + path + "`";
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') continue;
+    size_t end = line.find_last_not_of(" \t\r");
+
+    if (!ApplySetting(line.substr(begin, end - begin + 1), true, config,
+                      error)) {
+      std::ostringstream oss;
+      oss << path << ":" << line_number << ": " << *error;
+      *error = oss.str();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ApplyLoadSetting(const std::string& setting,
+                      lptc_coderdojo::LoadConfig* config, std::string* error) {
+  size_t pos = setting.find('=');
+  std::string key = setting.substr(0, pos);
+  std::string value =
+      pos == std::string::npos ? std::string() : setting.substr(pos + 1);
+  bool valid;
+
+  if (key == "help" && pos == std::string::npos) {
+    config->show_help = true;
+    return true;
+  }
+  if (pos == std::string::npos) {
+    *error = "expected key=value, got `" + setting + "`";
+    return false;
+  }
+
+  if (key == "host") {
+    config->host = value;
+    valid = !value.empty();
+  } else if (key == "port") {
+    valid = lptc_coderdojo::ParseIntValue(value, 1, 65535, &config->port);
+  } else if (key == "clients") {
+    valid = lptc_coderdojo::ParseIntValue(value, 1, kMaxLoadClients,
+                                          &config->clients);
+  } else if (key == "topics") {
+    valid = ParseTopicsValue(value, &config->topics);
+  } else if (key == "params") {
+    config->params = value;
+    valid = true;
+  } else if (key == "warmup-s") {
+    valid = ParseSecondsValue(value, 0, &config->warmup);
+  } else if (key == "duration-s") {
+    valid = ParseSecondsValue(value, 1, &config->duration);
+  } else if (key == "io-threads") {
+    valid = ParseThreadsValue(value, &config->io_threads);
+  } else {
+    *error = "unknown setting `" + key + "`";
+    return false;
+  }
+
+  if (!valid) *error = "invalid value `" + value + "` for `" + key + "`";
+  return valid;
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+const char* ResolutionName(Resolution resolution) {
+  switch (resolution) {
+    case Resolution::HIGH:
+      return "high";
+    case Resolution::MEDIUM:
+    default:
+      return "medium";
+  }
+}
+
+const char* VideoFormatName(VideoFormat format) {
+  switch (format) {
+    case VideoFormat::BAYER:
+      return "bayer";
+    case VideoFormat::IR:
+      return "ir";
+    case VideoFormat::RGB:
+    default:
+      return "rgb";
+  }
+}
+
+const char* DepthFormatName(DepthFormat format) {
+  switch (format) {
+    case DepthFormat::REGISTERED:
+      return "registered";
+    case DepthFormat::MM:
+      return "mm";
+    case DepthFormat::RAW11:
+    default:
+      return "11bit";
+  }
+}
+
+const char* DeviceSourceName(DeviceSource source) {
+  switch (source) {
+    case DeviceSource::SYNTHETIC:
+      return "synthetic";
+    case DeviceSource::REPLAY:
+      return "replay";
+    case DeviceSource::KINECT:
+    default:
+      return "kinect";
+  }
+}
+
+const char* ReplayModeName(ReplayMode mode) {
+  switch (mode) {
+    case ReplayMode::MAX_SPEED:
+      return "max";
+    case ReplayMode::REALTIME:
+    default:
+      return "realtime";
+  }
+}
+
+bool ResolutionFromName(const std::string& name, Resolution* resolution) {
+  const Resolution all[] = {Resolution::MEDIUM, Resolution::HIGH};
+  for (Resolution candidate : all) {
+    if (name.compare(ResolutionName(candidate)) == 0) {
+      *resolution = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool VideoFormatFromName(const std::string& name, VideoFormat* format) {
+  const VideoFormat all[] = {VideoFormat::RGB, VideoFormat::BAYER,
+                             VideoFormat::IR};
+  for (VideoFormat candidate : all) {
+    if (name.compare(VideoFormatName(candidate)) == 0) {
+      *format = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DepthFormatFromName(const std::string& name, DepthFormat* format) {
+  const DepthFormat all[] = {DepthFormat::RAW11, DepthFormat::REGISTERED,
+                             DepthFormat::MM};
+  for (DepthFormat candidate : all) {
+    if (name.compare(DepthFormatName(candidate)) == 0) {
+      *format = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DeviceSourceFromName(const std::string& name, DeviceSource* source) {
+  const DeviceSource all[] = {DeviceSource::KINECT, DeviceSource::SYNTHETIC,
+                              DeviceSource::REPLAY};
+  for (DeviceSource candidate : all) {
+    if (name.compare(DeviceSourceName(candidate)) == 0) {
+      *source = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReplayModeFromName(const std::string& name, ReplayMode* mode) {
+  const ReplayMode all[] = {ReplayMode::REALTIME, ReplayMode::MAX_SPEED};
+  for (ReplayMode candidate : all) {
+    if (name.compare(ReplayModeName(candidate)) == 0) {
+      *mode = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+int GetVideoChannels(VideoFormat format) {
+  return format == VideoFormat::IR ? 1 : 3;
+}
+
+uint16_t GetDepthNoReading(DepthFormat format) {
+  return format == DepthFormat::RAW11 ? 2047 : 0;
+}
+
+bool ParseIntValue(const std::string& value, int min, int max, int* result) {
+  char* end;
+  long parsed = std::strtol(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0' || parsed < min || parsed > max)
+    return false;
+
+  *result = static_cast<int>(parsed);
+  return true;
+}
+
+DeviceConfig::DeviceConfig()
+    : video_resolution(Resolution::MEDIUM),
+      video_format(VideoFormat::RGB),
+      depth_format(DepthFormat::RAW11),
+      max_fps(0),
+      sync_tolerance(std::chrono::milliseconds(kDefaultSyncToleranceMs)) {}
+
+ReplayConfig::ReplayConfig() : mode(ReplayMode::REALTIME), loops(0) {}
+
+ServerConfig::ServerConfig()
+    : port(kDefaultPort),
+      io_threads(0),
+      transform_threads(0),
+      source(DeviceSource::KINECT),
+      record_depth_encoding(Encoding::RAW16),
+      record_video_encoding(Encoding::RGB),
+      show_help(false) {}
+
+bool ParseCommandLine(int argc, const char* const argv[], ServerConfig* config,
+                      std::string* error) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.compare(0, 2, "--") != 0) {
+      *error = "unexpected argument `" + arg + "`";
+      return false;
+    }
+    if (!ApplySetting(arg.substr(2), false, config, error)) return false;
+  }
+  return true;
+}
+
+std::string GetUsage(const std::string& program) {
+  std::ostringstream oss;
+  oss << "Usage: " << program << " [--key=value ...]\n"
+      << "  --port=N                 websocket port (default " << kDefaultPort
+      << ")\n"
+      << "  --source=S               kinect (default), synthetic or replay\n"
+      << "  --devices=LIST           Kinect indices, e.g. 0,2 (default all)\n"
+      << "  --video-resolution=R     medium or high (default medium)\n"
+      << "  --video-format=F         rgb, bayer or ir (default rgb)\n"
+      << "  --depth-format=F         11bit, registered or mm (default 11bit)\n"
+      << "  --max-fps=N              frames kept per second, 0 for all\n"
+      << "                           (synthetic devices render 30 at 0)\n"
+      << "  --sync-tolerance-ms=N    rgbd pairing tolerance (default "
+      << kDefaultSyncToleranceMs << ")\n"
+      << "  --io-threads=N           websocket threads, 0 for auto\n"
+      << "  --transform-threads=N    threads per frame transform, 0 for auto\n"
+      << "  --record=FILE            record depth and video to a capture file\n"
+      << "  --record-depth=E         recorded depth encoding (default raw16)\n"
+      << "  --record-video=E         recorded video encoding (default rgb)\n"
+      << "  --replay=FILE            capture file for --source=replay\n"
+      << "  --replay-mode=M          realtime or max (default realtime)\n"
+      << "  --replay-loops=N         passes through the file, 0 to loop\n"
+      << "  --config=FILE            read key=value lines from FILE\n"
+      << "  --help                   show this message\n";
+  return oss.str();
+}
+
+LoadConfig::LoadConfig()
+    : host("localhost"),
+      port(kDefaultPort),
+      clients(kDefaultLoadClients),
+      topics({"video", "depth"}),
+      warmup(kDefaultWarmupS),
+      duration(kDefaultDurationS),
+      io_threads(0),
+      show_help(false) {}
+
+bool ParseLoadCommandLine(int argc, const char* const argv[],
+                          LoadConfig* config, std::string* error) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.compare(0, 2, "--") != 0) {
+      *error = "unexpected argument `" + arg + "`";
+      return false;
+    }
+    if (!ApplyLoadSetting(arg.substr(2), config, error)) return false;
+  }
+  return true;
+}
+
+std::string GetLoadUsage(const std::string& program) {
+  std::ostringstream oss;
+  oss << "Usage: " << program << " [--key=value ...]\n"
+      << "  --host=H                 server host (default localhost)\n"
+      << "  --port=N                 server port (default " << kDefaultPort
+      << ")\n"
+      << "  --clients=N              websocket clients (default "
+      << kDefaultLoadClients << ")\n"
+      << "  --topics=LIST            channels per client (default "
+         "video,depth)\n"
+      << "  --params=P               SUBSCRIBE parameters, e.g. "
+         "\"format=jpeg fps=15\"\n"
+      << "  --warmup-s=N             seconds before measuring (default "
+      << kDefaultWarmupS << ")\n"
+      << "  --duration-s=N           seconds measured (default "
+      << kDefaultDurationS << ")\n"
+      << "  --io-threads=N           websocket threads, 0 for auto\n"
+      << "  --help                   show this message\n";
+  return oss.str();
+}
+
+}  // namespace lptc_coderdojo
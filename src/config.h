@@ -0,0 +1,141 @@
+#ifndef LPTC_CODERDOJO_CONFIG_H_
+#define LPTC_CODERDOJO_CONFIG_H_
+
+#include "encoding.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Video resolutions the Kinect supports: 640x480 and 1280x1024. IR frames
+// are 8 rows taller. Depth is only available at the medium resolution.
+enum class Resolution { MEDIUM, HIGH };
+// RGB is demosaiced by libfreenect. BAYER is demosaiced by the server with a
+// cheaper, blockier filter. IR is the 8-bit infrared image, one sample per
+// pixel.
+enum class VideoFormat { RGB, BAYER, IR };
+// RAW11 is the sensor's 11-bit disparity, 2047 meaning no reading. The other
+// two are distances in millimetres, 0 meaning no reading; REGISTERED is
+// aligned to the video camera's viewpoint.
+enum class DepthFormat { RAW11, REGISTERED, MM };
+// Where frames come from: attached Kinects, SyntheticKinectDevice rendering
+// a moving test scene without hardware, or ReplayKinectDevice playing back a
+// capture file.
+enum class DeviceSource { KINECT, SYNTHETIC, REPLAY };
+// REALTIME keeps the recorded frame timing. MAX_SPEED hands out frames as
+// fast as the publishers take them, to measure throughput.
+enum class ReplayMode { REALTIME, MAX_SPEED };
+
+const char* ResolutionName(Resolution resolution);
+const char* VideoFormatName(VideoFormat format);
+const char* DepthFormatName(DepthFormat format);
+const char* DeviceSourceName(DeviceSource source);
+const char* ReplayModeName(ReplayMode mode);
+bool ResolutionFromName(const std::string& name, Resolution* resolution);
+bool VideoFormatFromName(const std::string& name, VideoFormat* format);
+bool DepthFormatFromName(const std::string& name, DepthFormat* format);
+bool DeviceSourceFromName(const std::string& name, DeviceSource* source);
+bool ReplayModeFromName(const std::string& name, ReplayMode* mode);
+
+// Samples per pixel in the video frames the device hands to publishers.
+int GetVideoChannels(VideoFormat format);
+// The depth sample that means "no reading" in `format`.
+uint16_t GetDepthNoReading(DepthFormat format);
+
+// Highest frame rate the Kinect delivers, and so the highest limit the
+// device-wide max_fps and a subscriber's fps accept.
+const int kMaxFps = 30;
+
+// Parses a decimal integer in [min, max] into `result`. Returns false for
+// anything else, leaving `result` untouched.
+bool ParseIntValue(const std::string& value, int min, int max, int* result);
+
+// How early a frame may go out under a frame rate limit, so that capture
+// jitter does not push it to the next frame and lower the effective rate.
+// Shared by the device-wide limit and each subscriber's fps.
+const std::chrono::milliseconds kPacingSlack(5);
+
+// Modes every opened device is configured with.
+struct DeviceConfig {
+  DeviceConfig();
+
+  Resolution video_resolution;
+  VideoFormat video_format;
+  DepthFormat depth_format;
+  // Frames per second kept from each stream, or 0 for every frame.
+  int max_fps;
+  // Largest capture time difference between a depth frame and the video
+  // frame it is paired with on the rgbd channel.
+  std::chrono::microseconds sync_tolerance;
+};
+
+// How a capture file is played back.
+struct ReplayConfig {
+  ReplayConfig();
+
+  std::string path;
+  ReplayMode mode;
+  // Passes through the file, or 0 to loop until shut down.
+  int loops;
+};
+
+struct ServerConfig {
+  ServerConfig();
+
+  int port;
+  // 0 picks a default from the number of cores.
+  size_t io_threads;
+  size_t transform_threads;
+  DeviceSource source;
+  // Indices of the devices to open, in increasing order. Empty opens every
+  // attached or recorded device, or a single synthetic one.
+  std::vector<int> device_indices;
+  DeviceConfig device;
+  ReplayConfig replay;
+  // Capture file every device's depth and video frames are recorded to, or
+  // empty to record nothing, and the wire encodings they are recorded in.
+  std::string record_path;
+  Encoding record_depth_encoding;
+  Encoding record_video_encoding;
+  bool show_help;
+};
+
+// Parses `--key=value` flags into `config`, leaving unmentioned settings as
+// they are. `--config=FILE` reads the same keys from FILE, one `key=value`
+// per line without the dashes; blank lines and lines starting with `#` are
+// ignored. Later settings override earlier ones. Returns false and sets
+// `error` for unknown keys, malformed values and unreadable files.
+bool ParseCommandLine(int argc, const char* const argv[], ServerConfig* config,
+                      std::string* error);
+std::string GetUsage(const std::string& program);
+
+// Settings of the kinect_loadgen tool.
+struct LoadConfig {
+  LoadConfig();
+
+  std::string host;
+  int port;
+  int clients;
+  // Channels every client subscribes to, e.g. video, depth or kinect1/rgbd.
+  std::vector<std::string> topics;
+  // Appended to every SUBSCRIBE command, e.g. "format=jpeg fps=15".
+  std::string params;
+  std::chrono::seconds warmup;
+  std::chrono::seconds duration;
+  size_t io_threads;
+  bool show_help;
+};
+
+// Parses the load generator's `--key=value` flags into `config`, like
+// ParseCommandLine but without config files.
+bool ParseLoadCommandLine(int argc, const char* const argv[],
+                          LoadConfig* config, std::string* error);
+std::string GetLoadUsage(const std::string& program);
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_CONFIG_H_
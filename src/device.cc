@@ -1,102 +1,272 @@
 #include "device.h"
+#include "transform.h"
 
-#include <functional>
+#include <algorithm>
+#include <stdexcept>
 
-namespace lptc_coderdojo {
-
-const std::chrono::milliseconds kLockTimeout = std::chrono::milliseconds(30);
+namespace {
 
-template <typename T>
-FrameQueue<T>::FrameQueue() {}
-
-template <typename T>
-void FrameQueue<T>::Push(const std::vector<T>& data) {
-  std::lock_guard<std::mutex> guard(queue_lock);
-  queue.push(data);
-  queue_cond.notify_one();
+freenect_resolution ToFreenectResolution(
+    lptc_coderdojo::Resolution resolution) {
+  return resolution == lptc_coderdojo::Resolution::HIGH
+             ? FREENECT_RESOLUTION_HIGH
+             : FREENECT_RESOLUTION_MEDIUM;
 }
 
-template <typename T>
-bool FrameQueue<T>::Pop(std::vector<T>& data,
-                        const std::chrono::milliseconds& timeout) {
-  std::unique_lock<std::mutex> lock(queue_lock);
+// The Bayer pattern is demosaiced in the callback, so publishers only ever
+// see RGB or IR frames.
+freenect_video_format ToFreenectVideoFormat(
+    lptc_coderdojo::VideoFormat format) {
+  switch (format) {
+    case lptc_coderdojo::VideoFormat::BAYER:
+      return FREENECT_VIDEO_BAYER;
+    case lptc_coderdojo::VideoFormat::IR:
+      return FREENECT_VIDEO_IR_8BIT;
+    case lptc_coderdojo::VideoFormat::RGB:
+    default:
+      return FREENECT_VIDEO_RGB;
+  }
+}
 
-  if (queue.empty()) {
-    if (queue_cond.wait_for(lock, timeout,
-                            std::bind(&FrameQueue::QueueNotEmptyPred, this))) {
-      return PopInternal(data);
-    } else {
-      return false;
-    }
-  } else {
-    return PopInternal(data);
+freenect_depth_format ToFreenectDepthFormat(
+    lptc_coderdojo::DepthFormat format) {
+  switch (format) {
+    case lptc_coderdojo::DepthFormat::REGISTERED:
+      return FREENECT_DEPTH_REGISTERED;
+    case lptc_coderdojo::DepthFormat::MM:
+      return FREENECT_DEPTH_MM;
+    case lptc_coderdojo::DepthFormat::RAW11:
+    default:
+      return FREENECT_DEPTH_11BIT;
   }
-  return false;
 }
 
-template <typename T>
-bool FrameQueue<T>::PopInternal(std::vector<T>& data) {
-  data = queue.front();
-  queue.pop();
-  return true;
+freenect_frame_mode FindVideoMode(const lptc_coderdojo::DeviceConfig& config) {
+  freenect_frame_mode mode =
+      freenect_find_video_mode(ToFreenectResolution(config.video_resolution),
+                               ToFreenectVideoFormat(config.video_format));
+  if (!mode.is_valid) {
+    throw std::runtime_error(
+        std::string("Kinect has no ") +
+        lptc_coderdojo::ResolutionName(config.video_resolution) + " " +
+        lptc_coderdojo::VideoFormatName(config.video_format) + " video mode");
+  }
+  return mode;
 }
 
-template <typename T>
-bool FrameQueue<T>::QueueNotEmptyPred() {
-  return !queue.empty();
+// The Kinect only produces depth at the medium resolution.
+freenect_frame_mode FindDepthMode(const lptc_coderdojo::DeviceConfig& config) {
+  freenect_frame_mode mode = freenect_find_depth_mode(
+      FREENECT_RESOLUTION_MEDIUM, ToFreenectDepthFormat(config.depth_format));
+  if (!mode.is_valid) {
+    throw std::runtime_error(
+        std::string("Kinect has no ") +
+        lptc_coderdojo::DepthFormatName(config.depth_format) + " depth mode");
+  }
+  return mode;
 }
 
-OpenKinectDevice::OpenKinectDevice(freenect_context* ctx, int index)
-    : Freenect::FreenectDevice(ctx, index) {
-  setVideoFormat(FREENECT_VIDEO_RGB);
-  setDepthFormat(FREENECT_DEPTH_11BIT);
+}  // namespace
+
+namespace lptc_coderdojo {
+
+OpenKinectDevice::OpenKinectDevice(freenect_context* ctx, int index,
+                                   const DeviceConfig& _config)
+    : Freenect::FreenectDevice(ctx, index),
+      config(_config),
+      frame_interval(
+          config.max_fps
+              ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::seconds(1)) /
+                    config.max_fps
+              : std::chrono::steady_clock::duration::zero()),
+      depth_mode(FindDepthMode(config)),
+      video_mode(FindVideoMode(config)),
+      depth_pool(kDefaultFrameQueueDepth + kFramesInFlight,
+                 depth_mode.width * depth_mode.height),
+      video_pool(kDefaultFrameQueueDepth + kFramesInFlight,
+                 video_mode.width * video_mode.height *
+                     GetVideoChannels(config.video_format)),
+      depth_frames(kDefaultFrameQueueDepth),
+      video_frames(kDefaultFrameQueueDepth),
+      synchronizer(config.sync_tolerance),
+      queue_depth(false),
+      queue_video(false),
+      sync_frames(false),
+      depth_running(false),
+      video_running(false) {
+  setVideoFormat(video_mode.video_format, video_mode.resolution);
+  setDepthFormat(depth_mode.depth_format, depth_mode.resolution);
   freenect_set_log_level(ctx, FREENECT_LOG_ERROR);
-  depth_mode = freenect_find_depth_mode(FREENECT_RESOLUTION_MEDIUM,
-                                        FREENECT_DEPTH_11BIT);
-  video_mode =
-      freenect_find_video_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_VIDEO_RGB);
 }
 
 void OpenKinectDevice::DepthCallback(void* _depth, uint32_t timestamp) {
+  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+  bool queued = queue_depth.load();
+  bool synced = sync_frames.load();
+  if ((!queued && !synced) || !IsFrameDue(depth_due)) return;
+  DepthFramePtr frame = depth_pool.Acquire();
+  if (!frame) return;
+
   uint16_t* depth = static_cast<uint16_t*>(_depth);
-  int len = GetDepthFrameRectSize();
-  std::vector<uint16_t> buf;
-  buf.resize(len);
-  std::copy(depth, depth + len, buf.begin());
-  depth_frames.Push(buf);
+  std::copy(depth, depth + frame->data.size(), frame->data.begin());
+  frame->timestamp = timestamp;
+  frame->capture_time = now;
+  frame->queued_time = std::chrono::system_clock::now();
+  if (synced) synchronizer.AddDepth(frame);
+  if (queued) depth_frames.Push(std::move(frame));
 }
 
 void OpenKinectDevice::VideoCallback(void* _video, uint32_t timestamp) {
+  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+  bool queued = queue_video.load();
+  bool synced = sync_frames.load();
+  if ((!queued && !synced) || !IsFrameDue(video_due)) return;
+  VideoFramePtr frame = video_pool.Acquire();
+  if (!frame) return;
+
   uint8_t* video = static_cast<uint8_t*>(_video);
-  int len = GetVideoFrameRectSize() * 3;
-  std::vector<uint8_t> buf;
-  buf.resize(len);
-  std::copy(video, video + len, buf.begin());
-  video_frames.Push(buf);
+  if (config.video_format == VideoFormat::BAYER) {
+    TransformBayerToRgb(video, video_mode.width, video_mode.height,
+                        frame->data.data());
+  } else {
+    std::copy(video, video + frame->data.size(), frame->data.begin());
+  }
+  frame->timestamp = timestamp;
+  frame->capture_time = now;
+  frame->queued_time = std::chrono::system_clock::now();
+  if (synced) synchronizer.AddVideo(frame);
+  if (queued) video_frames.Push(std::move(frame));
 }
 
+int OpenKinectDevice::GetDepthFrameWidth() { return depth_mode.width; }
+
+int OpenKinectDevice::GetDepthFrameHeight() { return depth_mode.height; }
+
 int OpenKinectDevice::GetDepthFrameRectSize() {
   return depth_mode.width * depth_mode.height;
 }
 
+int OpenKinectDevice::GetVideoFrameWidth() { return video_mode.width; }
+
+int OpenKinectDevice::GetVideoFrameHeight() { return video_mode.height; }
+
 int OpenKinectDevice::GetVideoFrameRectSize() {
   return video_mode.width * video_mode.height;
 }
 
-bool OpenKinectDevice::GetNextDepthFrame(std::vector<uint16_t>& frame) {
-  return depth_frames.Pop(frame, kLockTimeout);
+VideoFormat OpenKinectDevice::GetVideoFormat() { return config.video_format; }
+
+DepthFormat OpenKinectDevice::GetDepthFormat() { return config.depth_format; }
+
+bool OpenKinectDevice::GetNextDepthFrame(DepthFramePtr& frame) {
+  return depth_frames.Pop(frame);
+}
+
+bool OpenKinectDevice::GetNextVideoFrame(VideoFramePtr& frame) {
+  return video_frames.Pop(frame);
+}
+
+bool OpenKinectDevice::GetNextRgbdFrame(RgbdFrame& pair) {
+  return synchronizer.Pop(pair);
+}
+
+void OpenKinectDevice::StartDepth() {
+  std::lock_guard<std::mutex> guard(stream_lock);
+  queue_depth = true;
+  UpdateStreams();
+}
+
+void OpenKinectDevice::StartVideo() {
+  std::lock_guard<std::mutex> guard(stream_lock);
+  queue_video = true;
+  UpdateStreams();
+}
+
+void OpenKinectDevice::StartRgbd() {
+  std::lock_guard<std::mutex> guard(stream_lock);
+  sync_frames = true;
+  UpdateStreams();
+}
+
+// Frames still queued would be stale by the time the consumer restarts.
+void OpenKinectDevice::StopDepth() {
+  std::lock_guard<std::mutex> guard(stream_lock);
+  queue_depth = false;
+  UpdateStreams();
+  depth_frames.Clear();
 }
 
-bool OpenKinectDevice::GetNextVideoFrame(std::vector<uint8_t>& frame) {
-  return video_frames.Pop(frame, kLockTimeout);
+void OpenKinectDevice::StopVideo() {
+  std::lock_guard<std::mutex> guard(stream_lock);
+  queue_video = false;
+  UpdateStreams();
+  video_frames.Clear();
 }
 
-void OpenKinectDevice::StartDepth() { startDepth(); }
+void OpenKinectDevice::StopRgbd() {
+  std::lock_guard<std::mutex> guard(stream_lock);
+  sync_frames = false;
+  UpdateStreams();
+  synchronizer.Clear();
+}
+
+void OpenKinectDevice::Shutdown() {
+  depth_frames.Close();
+  video_frames.Close();
+  synchronizer.Close();
+}
 
-void OpenKinectDevice::StartVideo() { startVideo(); }
+StreamStats OpenKinectDevice::GetDepthStats() {
+  return {depth_frames.GetSize(), GetDroppedDepthFrames()};
+}
 
-void OpenKinectDevice::StopDepth() { stopDepth(); }
+StreamStats OpenKinectDevice::GetVideoStats() {
+  return {video_frames.GetSize(), GetDroppedVideoFrames()};
+}
+
+StreamStats OpenKinectDevice::GetRgbdStats() {
+  return {synchronizer.GetPendingPairs(), synchronizer.GetDroppedPairs()};
+}
 
-void OpenKinectDevice::StopVideo() { stopVideo(); }
+void OpenKinectDevice::SetFrameQueuePolicy(size_t depth,
+                                           OverflowPolicy policy) {
+  depth_pool.Grow(depth + kFramesInFlight);
+  video_pool.Grow(depth + kFramesInFlight);
+  depth_frames.Reconfigure(depth, policy);
+  video_frames.Reconfigure(depth, policy);
+}
+
+size_t OpenKinectDevice::GetDroppedDepthFrames() const {
+  return depth_frames.GetDroppedFrames() + depth_pool.GetMisses();
+}
+
+size_t OpenKinectDevice::GetDroppedVideoFrames() const {
+  return video_frames.GetDroppedFrames() + video_pool.GetMisses();
+}
+
+bool OpenKinectDevice::IsFrameDue(std::chrono::steady_clock::time_point& due) {
+  if (frame_interval == std::chrono::steady_clock::duration::zero())
+    return true;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now + kPacingSlack < due) return false;
+
+  due += frame_interval;
+  if (due < now) due = now + frame_interval;
+  return true;
+}
+
+void OpenKinectDevice::UpdateStreams() {
+  bool depth_wanted = queue_depth || sync_frames;
+  bool video_wanted = queue_video || sync_frames;
+
+  if (depth_wanted && !depth_running) startDepth();
+  if (!depth_wanted && depth_running) stopDepth();
+  if (video_wanted && !video_running) startVideo();
+  if (!video_wanted && video_running) stopVideo();
+  depth_running = depth_wanted;
+  video_running = video_wanted;
+}
 
 }  // namespace lptc_coderdojo
\ No newline at end of file
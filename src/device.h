@@ -1,29 +1,32 @@
 #ifndef LPTC_CODERDOJO_DEVICE_H_
 #define LPTC_CODERDOJO_DEVICE_H_
 
+#include "config.h"
+#include "frame.h"
+#include "frame_queue.h"
+#include "frame_synchronizer.h"
 #include "libfreenect.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <mutex>
-#include <queue>
 #include <vector>
 
 namespace lptc_coderdojo {
 
-template <typename T>
-class FrameQueue {
- public:
-  FrameQueue();
-
-  void Push(const std::vector<T>& data);
-  bool Pop(std::vector<T>&, const std::chrono::milliseconds& timeout);
-
- private:
-  bool PopInternal(std::vector<T>&);
-  bool QueueNotEmptyPred();
-
-  std::queue<std::vector<T>> queue;
-  std::mutex queue_lock;
-  std::condition_variable queue_cond;
+const size_t kDefaultFrameQueueDepth = 4;
+// Frames that can be outside the queue at once: one being filled by the
+// callback, one being transformed by the publisher, two held by the JPEG
+// worker, one being encoded and one waiting, and those held by the frame
+// synchronizer plus the pair being published from it.
+const size_t kFramesInFlight = 4 + kMaxSynchronizedFrames + 1;
+
+// Frames of one stream waiting for their consumer, and frames the stream
+// lost since the device was opened: queue overflows and frames the pool had
+// no room for, or for the rgbd stream, pairs its consumer fell behind on.
+struct StreamStats {
+  size_t queued_frames;
+  size_t dropped_frames;
 };
 
 class KinectDevice {
@@ -31,38 +34,107 @@ class KinectDevice {
   KinectDevice() = default;
   virtual ~KinectDevice() = default;
 
+  virtual int GetDepthFrameWidth() = 0;
+  virtual int GetDepthFrameHeight() = 0;
   virtual int GetDepthFrameRectSize() = 0;
+  virtual int GetVideoFrameWidth() = 0;
+  virtual int GetVideoFrameHeight() = 0;
   virtual int GetVideoFrameRectSize() = 0;
-  virtual bool GetNextDepthFrame(std::vector<uint16_t>&) = 0;
-  virtual bool GetNextVideoFrame(std::vector<uint8_t>&) = 0;
+  // Video frames hold GetVideoChannels(GetVideoFormat()) samples per pixel.
+  virtual lptc_coderdojo::VideoFormat GetVideoFormat() = 0;
+  virtual lptc_coderdojo::DepthFormat GetDepthFormat() = 0;
+  // Block until the next frame arrives. Return false once the device has
+  // been shut down.
+  virtual bool GetNextDepthFrame(DepthFramePtr&) = 0;
+  virtual bool GetNextVideoFrame(VideoFramePtr&) = 0;
+  // Blocks until a depth frame and a video frame captured within the
+  // synchronizer's tolerance of each other are available.
+  virtual bool GetNextRgbdFrame(RgbdFrame&) = 0;
+  // Each consumer starts and stops independently. The device keeps a
+  // stream running while any consumer that reads it is started.
   virtual void StartVideo() = 0;
   virtual void StartDepth() = 0;
+  virtual void StartRgbd() = 0;
   virtual void StopVideo() = 0;
   virtual void StopDepth() = 0;
+  virtual void StopRgbd() = 0;
+  // Wakes every thread waiting for a frame. Irreversible.
+  virtual void Shutdown() = 0;
+  virtual lptc_coderdojo::StreamStats GetDepthStats() = 0;
+  virtual lptc_coderdojo::StreamStats GetVideoStats() = 0;
+  virtual lptc_coderdojo::StreamStats GetRgbdStats() = 0;
 };
 
 class OpenKinectDevice : public KinectDevice, public Freenect::FreenectDevice {
  public:
-  OpenKinectDevice(freenect_context* ctx, int index);
+  typedef FramePool<uint16_t> DepthFramePool;
+  typedef FramePool<uint8_t> VideoFramePool;
+  typedef FrameQueue<uint16_t> DepthFrameQueue;
+  typedef FrameQueue<uint8_t> VideoFrameQueue;
+
+  // Throws std::runtime_error when the device has no mode matching
+  // `config`.
+  OpenKinectDevice(freenect_context* ctx, int index,
+                   const lptc_coderdojo::DeviceConfig& config);
 
   void DepthCallback(void* _depth, uint32_t timestamp);
   void VideoCallback(void* _rgb, uint32_t timestamp);
 
+  int GetDepthFrameWidth();
+  int GetDepthFrameHeight();
   int GetDepthFrameRectSize();
+  int GetVideoFrameWidth();
+  int GetVideoFrameHeight();
   int GetVideoFrameRectSize();
-  bool GetNextDepthFrame(std::vector<uint16_t>&);
-  bool GetNextVideoFrame(std::vector<uint8_t>&);
+  lptc_coderdojo::VideoFormat GetVideoFormat();
+  lptc_coderdojo::DepthFormat GetDepthFormat();
+  bool GetNextDepthFrame(DepthFramePtr&);
+  bool GetNextVideoFrame(VideoFramePtr&);
+  bool GetNextRgbdFrame(RgbdFrame&);
   void StartDepth();
   void StartVideo();
+  void StartRgbd();
   void StopDepth();
   void StopVideo();
+  void StopRgbd();
+  void Shutdown();
+  lptc_coderdojo::StreamStats GetDepthStats();
+  lptc_coderdojo::StreamStats GetVideoStats();
+  lptc_coderdojo::StreamStats GetRgbdStats();
+
+  void SetFrameQueuePolicy(size_t depth, OverflowPolicy policy);
+  size_t GetDroppedDepthFrames() const;
+  size_t GetDroppedVideoFrames() const;
 
  private:
+  // Advances `due` and returns true when a frame arriving now should be
+  // kept under the configured frame rate limit.
+  bool IsFrameDue(std::chrono::steady_clock::time_point& due);
+  // Starts or stops the device streams to match the started consumers.
+  // Called with stream_lock held.
+  void UpdateStreams();
+
+  const lptc_coderdojo::DeviceConfig config;
+  const std::chrono::steady_clock::duration frame_interval;
+  std::chrono::steady_clock::time_point depth_due;
+  std::chrono::steady_clock::time_point video_due;
+
   freenect_frame_mode depth_mode;
   freenect_frame_mode video_mode;
 
-  FrameQueue<uint16_t> depth_frames;
-  FrameQueue<uint8_t> video_frames;
+  DepthFramePool depth_pool;
+  VideoFramePool video_pool;
+  DepthFrameQueue depth_frames;
+  VideoFrameQueue video_frames;
+  FrameSynchronizer synchronizer;
+
+  // Read by the callbacks to decide where each frame goes.
+  std::atomic<bool> queue_depth;
+  std::atomic<bool> queue_video;
+  std::atomic<bool> sync_frames;
+  bool depth_running;
+  bool video_running;
+  std::mutex stream_lock;
 };
 
 }  // namespace lptc_coderdojo
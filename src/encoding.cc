@@ -0,0 +1,35 @@
+#include "encoding.h"
+
+namespace lptc_coderdojo {
+
+const char* EncodingName(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::RAW16:
+      return "raw16";
+    case Encoding::PACKED11:
+      return "packed11";
+    case Encoding::RGB:
+      return "rgb";
+    case Encoding::RVL:
+      return "rvl";
+    case Encoding::JPEG:
+      return "jpeg";
+    case Encoding::RGBA:
+    default:
+      return "rgba";
+  }
+}
+
+bool EncodingFromName(const std::string& name, Encoding* encoding) {
+  const Encoding all[] = {Encoding::RGBA, Encoding::RAW16, Encoding::PACKED11,
+                          Encoding::RGB, Encoding::RVL, Encoding::JPEG};
+  for (Encoding candidate : all) {
+    if (name.compare(EncodingName(candidate)) == 0) {
+      *encoding = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,17 @@
+#ifndef LPTC_CODERDOJO_ENCODING_H_
+#define LPTC_CODERDOJO_ENCODING_H_
+
+#include <string>
+
+namespace lptc_coderdojo {
+
+// Wire encodings a subscriber can ask for. RGBA is what the web client has
+// always received and stays the default.
+enum class Encoding { RGBA, RAW16, PACKED11, RGB, RVL, JPEG };
+
+const char* EncodingName(Encoding encoding);
+bool EncodingFromName(const std::string& name, Encoding* encoding);
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_ENCODING_H_
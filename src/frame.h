@@ -0,0 +1,101 @@
+#ifndef LPTC_CODERDOJO_FRAME_H_
+#define LPTC_CODERDOJO_FRAME_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+template <typename T>
+struct Frame {
+  std::vector<T> data;
+  // The device's own clock, as reported with the frame.
+  uint32_t timestamp;
+  // Server wall clock time when the frame arrived from the device.
+  std::chrono::system_clock::time_point capture_time;
+  // Server wall clock time when the device handed the frame to its queues.
+  std::chrono::system_clock::time_point queued_time;
+};
+
+typedef std::shared_ptr<Frame<uint16_t>> DepthFramePtr;
+typedef std::shared_ptr<Frame<uint8_t>> VideoFramePtr;
+
+// Fixed set of preallocated, reference-counted frames. A frame is free again
+// once the pool holds the only reference to it, so handing frames from a
+// device callback through a FrameQueue to a publisher never copies or
+// allocates after construction.
+template <typename T>
+class FramePool {
+ public:
+  typedef std::shared_ptr<Frame<T>> FramePtr;
+
+  FramePool(size_t size, size_t frame_len);
+
+  FramePtr Acquire();
+  void Grow(size_t size);
+  size_t GetMisses() const;
+  size_t GetSize();
+
+ private:
+  std::vector<FramePtr> frames;
+  size_t frame_len;
+  size_t next;
+  std::atomic<size_t> misses;
+  std::mutex pool_lock;
+};
+
+template <typename T>
+FramePool<T>::FramePool(size_t size, size_t _frame_len)
+    : frame_len(_frame_len), next(0), misses(0) {
+  Grow(size);
+}
+
+template <typename T>
+typename FramePool<T>::FramePtr FramePool<T>::Acquire() {
+  std::lock_guard<std::mutex> guard(pool_lock);
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    size_t index = (next + i) % frames.size();
+    if (frames[index].use_count() == 1) {
+      // Pairs with the release in the last consumer's reference drop, so its
+      // reads of the frame happen before we hand the frame out for writing.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      next = (index + 1) % frames.size();
+      return frames[index];
+    }
+  }
+
+  misses++;
+  return FramePtr();
+}
+
+template <typename T>
+void FramePool<T>::Grow(size_t size) {
+  std::lock_guard<std::mutex> guard(pool_lock);
+
+  while (frames.size() < size) {
+    FramePtr frame = std::make_shared<Frame<T>>();
+    frame->data.resize(frame_len);
+    frame->timestamp = 0;
+    frames.push_back(frame);
+  }
+}
+
+template <typename T>
+size_t FramePool<T>::GetMisses() const {
+  return misses.load();
+}
+
+template <typename T>
+size_t FramePool<T>::GetSize() {
+  std::lock_guard<std::mutex> guard(pool_lock);
+  return frames.size();
+}
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_FRAME_H_
@@ -0,0 +1,158 @@
+#ifndef LPTC_CODERDOJO_FRAME_QUEUE_H_
+#define LPTC_CODERDOJO_FRAME_QUEUE_H_
+
+#include "frame.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// What FrameQueue::Push does when every slot is occupied.
+enum class OverflowPolicy { DROP_OLDEST, DROP_NEWEST, BLOCK };
+
+// Fixed-capacity ring of frames shared between a device callback (producer)
+// and a publisher thread (consumer). Frames are reference counted and only
+// change hands, so Push and Pop never copy pixel data or allocate.
+template <typename T>
+class FrameQueue {
+ public:
+  typedef std::shared_ptr<Frame<T>> FramePtr;
+
+  FrameQueue(size_t capacity,
+             OverflowPolicy policy = OverflowPolicy::DROP_OLDEST);
+
+  void Push(FramePtr frame);
+  // Waits until a frame is available. Returns false once the queue is closed
+  // and drained.
+  bool Pop(FramePtr& frame);
+  // Wakes every waiting Pop and Push. Frames pushed afterwards are dropped.
+  void Close();
+  // Releases every queued frame without counting it as dropped.
+  void Clear();
+  void Reconfigure(size_t capacity, OverflowPolicy policy);
+
+  size_t GetCapacity();
+  size_t GetDroppedFrames() const;
+  size_t GetSize();
+
+ private:
+  void ResetSlots(size_t capacity);
+
+  std::vector<FramePtr> slots;
+  size_t head;
+  size_t count;
+  OverflowPolicy policy;
+  bool closed;
+  std::atomic<size_t> dropped_frames;
+
+  std::mutex queue_lock;
+  std::condition_variable not_empty_cond;
+  std::condition_variable not_full_cond;
+};
+
+template <typename T>
+FrameQueue<T>::FrameQueue(size_t capacity, OverflowPolicy _policy)
+    : head(0), count(0), policy(_policy), closed(false), dropped_frames(0) {
+  ResetSlots(capacity);
+}
+
+template <typename T>
+void FrameQueue<T>::Push(FramePtr frame) {
+  std::unique_lock<std::mutex> lock(queue_lock);
+
+  if (closed) return;
+  if (count == slots.size()) {
+    if (policy == OverflowPolicy::DROP_NEWEST) {
+      dropped_frames++;
+      return;
+    } else if (policy == OverflowPolicy::DROP_OLDEST) {
+      slots[head].reset();
+      head = (head + 1) % slots.size();
+      count--;
+      dropped_frames++;
+    } else {
+      not_full_cond.wait(lock,
+                         [this] { return closed || count < slots.size(); });
+      if (closed) return;
+    }
+  }
+
+  slots[(head + count) % slots.size()] = std::move(frame);
+  count++;
+  not_empty_cond.notify_one();
+}
+
+template <typename T>
+bool FrameQueue<T>::Pop(FramePtr& frame) {
+  std::unique_lock<std::mutex> lock(queue_lock);
+
+  not_empty_cond.wait(lock, [this] { return closed || count > 0; });
+  if (count == 0) return false;
+
+  frame = std::move(slots[head]);
+  head = (head + 1) % slots.size();
+  count--;
+  lock.unlock();
+  not_full_cond.notify_one();
+  return true;
+}
+
+template <typename T>
+void FrameQueue<T>::Close() {
+  {
+    std::lock_guard<std::mutex> guard(queue_lock);
+    closed = true;
+  }
+  not_empty_cond.notify_all();
+  not_full_cond.notify_all();
+}
+
+template <typename T>
+void FrameQueue<T>::Clear() {
+  {
+    std::lock_guard<std::mutex> guard(queue_lock);
+    ResetSlots(slots.size());
+  }
+  not_full_cond.notify_all();
+}
+
+template <typename T>
+void FrameQueue<T>::Reconfigure(size_t capacity, OverflowPolicy _policy) {
+  std::lock_guard<std::mutex> guard(queue_lock);
+  policy = _policy;
+  ResetSlots(capacity);
+  not_full_cond.notify_all();
+}
+
+template <typename T>
+size_t FrameQueue<T>::GetCapacity() {
+  std::lock_guard<std::mutex> guard(queue_lock);
+  return slots.size();
+}
+
+template <typename T>
+size_t FrameQueue<T>::GetDroppedFrames() const {
+  return dropped_frames.load();
+}
+
+template <typename T>
+size_t FrameQueue<T>::GetSize() {
+  std::lock_guard<std::mutex> guard(queue_lock);
+  return count;
+}
+
+template <typename T>
+void FrameQueue<T>::ResetSlots(size_t capacity) {
+  if (capacity == 0) capacity = 1;
+
+  slots.assign(capacity, FramePtr());
+  head = 0;
+  count = 0;
+}
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_FRAME_QUEUE_H_
@@ -0,0 +1,145 @@
+#include "frame_synchronizer.h"
+
+namespace {
+
+// Finds the frame in `candidates` captured closest to `time`, at most
+// `tolerance` away. Returns candidates.size() when there is none.
+template <typename FramePtr>
+size_t FindClosest(const std::deque<FramePtr>& candidates,
+                   std::chrono::system_clock::time_point time,
+                   std::chrono::microseconds tolerance) {
+  size_t best = candidates.size();
+  std::chrono::system_clock::duration best_distance = tolerance;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    std::chrono::system_clock::duration distance =
+        candidates[i]->capture_time - time;
+    if (distance < std::chrono::system_clock::duration::zero())
+      distance = -distance;
+    if (distance <= best_distance) {
+      best = i;
+      best_distance = distance;
+    }
+  }
+  return best;
+}
+
+// Takes the matched frame out of `candidates`, dropping the older ones
+// before it. Returns how many were dropped.
+template <typename FramePtr>
+size_t TakeMatch(std::deque<FramePtr>& candidates, size_t match,
+                 FramePtr* frame) {
+  *frame = std::move(candidates[match]);
+  candidates.erase(candidates.begin(), candidates.begin() + match + 1);
+  return match;
+}
+
+// Queues `frame` to wait for a partner. Returns how many old frames made
+// room for it.
+template <typename FramePtr>
+size_t AddPending(std::deque<FramePtr>& pending, FramePtr frame) {
+  size_t evicted = 0;
+  while (pending.size() >= lptc_coderdojo::kMaxPendingSyncFrames) {
+    pending.pop_front();
+    evicted++;
+  }
+  pending.push_back(std::move(frame));
+  return evicted;
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+FrameSynchronizer::FrameSynchronizer(std::chrono::microseconds _tolerance)
+    : tolerance(_tolerance),
+      closed(false),
+      unmatched_frames(0),
+      dropped_pairs(0) {}
+
+void FrameSynchronizer::AddDepth(DepthFramePtr frame) {
+  std::unique_lock<std::mutex> lock(sync_lock);
+  if (closed) return;
+
+  size_t match = FindClosest(pending_video, frame->capture_time, tolerance);
+  if (match == pending_video.size()) {
+    unmatched_frames += AddPending(pending_depth, std::move(frame));
+    return;
+  }
+
+  VideoFramePtr video;
+  unmatched_frames += TakeMatch(pending_video, match, &video);
+  PushPair(std::move(frame), std::move(video));
+  lock.unlock();
+  pair_cond.notify_one();
+}
+
+void FrameSynchronizer::AddVideo(VideoFramePtr frame) {
+  std::unique_lock<std::mutex> lock(sync_lock);
+  if (closed) return;
+
+  size_t match = FindClosest(pending_depth, frame->capture_time, tolerance);
+  if (match == pending_depth.size()) {
+    unmatched_frames += AddPending(pending_video, std::move(frame));
+    return;
+  }
+
+  DepthFramePtr depth;
+  unmatched_frames += TakeMatch(pending_depth, match, &depth);
+  PushPair(std::move(depth), std::move(frame));
+  lock.unlock();
+  pair_cond.notify_one();
+}
+
+bool FrameSynchronizer::Pop(RgbdFrame& pair) {
+  std::unique_lock<std::mutex> lock(sync_lock);
+
+  pair_cond.wait(lock, [this] { return closed || !pairs.empty(); });
+  if (closed) return false;
+
+  pair = std::move(pairs.front());
+  pairs.pop_front();
+  return true;
+}
+
+void FrameSynchronizer::Close() {
+  {
+    std::lock_guard<std::mutex> guard(sync_lock);
+    closed = true;
+  }
+  pair_cond.notify_all();
+}
+
+void FrameSynchronizer::Clear() {
+  std::lock_guard<std::mutex> guard(sync_lock);
+  pending_depth.clear();
+  pending_video.clear();
+  pairs.clear();
+}
+
+std::chrono::microseconds FrameSynchronizer::GetTolerance() const {
+  return tolerance;
+}
+
+size_t FrameSynchronizer::GetUnmatchedFrames() const {
+  return unmatched_frames.load();
+}
+
+size_t FrameSynchronizer::GetDroppedPairs() const {
+  return dropped_pairs.load();
+}
+
+size_t FrameSynchronizer::GetPendingPairs() {
+  std::lock_guard<std::mutex> guard(sync_lock);
+  return pairs.size();
+}
+
+void FrameSynchronizer::PushPair(DepthFramePtr depth, VideoFramePtr video) {
+  if (pairs.size() >= kMaxPendingRgbdFrames) {
+    pairs.pop_front();
+    dropped_pairs++;
+  }
+  RgbdFrame pair = {std::move(depth), std::move(video)};
+  pairs.push_back(std::move(pair));
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,73 @@
+#ifndef LPTC_CODERDOJO_FRAME_SYNCHRONIZER_H_
+#define LPTC_CODERDOJO_FRAME_SYNCHRONIZER_H_
+
+#include "frame.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace lptc_coderdojo {
+
+// Unmatched frames kept per stream while waiting for a partner.
+const size_t kMaxPendingSyncFrames = 2;
+// Matched pairs kept for a consumer that is behind. Older pairs are dropped.
+const size_t kMaxPendingRgbdFrames = 2;
+// Frames of each stream a synchronizer can hold at once.
+const size_t kMaxSynchronizedFrames =
+    kMaxPendingSyncFrames + kMaxPendingRgbdFrames;
+
+// A depth frame and the video frame captured closest to it.
+struct RgbdFrame {
+  DepthFramePtr depth;
+  VideoFramePtr video;
+};
+
+// Pairs depth and video frames whose capture times are at most `tolerance`
+// apart. Each stream arrives in capture order, so a new frame is paired
+// with the closest unmatched frame of the other stream, and unmatched frames
+// of the other stream captured before that one can no longer find a better
+// partner and are dropped. Keeping the tolerance under half a frame interval
+// makes every match unambiguous.
+class FrameSynchronizer {
+ public:
+  explicit FrameSynchronizer(std::chrono::microseconds tolerance);
+
+  void AddDepth(DepthFramePtr frame);
+  void AddVideo(VideoFramePtr frame);
+  // Waits until a pair is available. Returns false once the synchronizer is
+  // closed.
+  bool Pop(RgbdFrame& pair);
+  // Wakes every waiting Pop. Frames added afterwards are dropped.
+  void Close();
+  // Releases every held frame without counting it as unmatched.
+  void Clear();
+
+  std::chrono::microseconds GetTolerance() const;
+  // Frames that aged out or were passed over without a partner, and matched
+  // pairs dropped because the consumer fell behind.
+  size_t GetUnmatchedFrames() const;
+  size_t GetDroppedPairs() const;
+  // Matched pairs waiting for the consumer.
+  size_t GetPendingPairs();
+
+ private:
+  void PushPair(DepthFramePtr depth, VideoFramePtr video);
+
+  const std::chrono::microseconds tolerance;
+  std::deque<DepthFramePtr> pending_depth;
+  std::deque<VideoFramePtr> pending_video;
+  std::deque<RgbdFrame> pairs;
+  bool closed;
+  std::atomic<size_t> unmatched_frames;
+  std::atomic<size_t> dropped_pairs;
+
+  std::mutex sync_lock;
+  std::condition_variable pair_cond;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_FRAME_SYNCHRONIZER_H_
@@ -0,0 +1,41 @@
+#include "latency_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lptc_coderdojo {
+
+LatencyStats::LatencyStats() : sorted(true) {}
+
+void LatencyStats::Add(int64_t sample) {
+  samples.push_back(sample);
+  sorted = false;
+}
+
+void LatencyStats::Merge(const LatencyStats& other) {
+  samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+  sorted = false;
+}
+
+void LatencyStats::Clear() {
+  samples.clear();
+  sorted = true;
+}
+
+size_t LatencyStats::GetCount() const { return samples.size(); }
+
+int64_t LatencyStats::GetPercentile(double percentile) {
+  if (samples.empty()) return 0;
+  if (!sorted) {
+    std::sort(samples.begin(), samples.end());
+    sorted = true;
+  }
+
+  // The tolerance keeps 99.9 of 1000 samples, 999.0000000000001 in floating
+  // point, at rank 999.
+  double rank = std::ceil(percentile / 100 * samples.size() - 1e-9);
+  size_t index = rank < 1 ? 0 : static_cast<size_t>(rank) - 1;
+  return samples[std::min(index, samples.size() - 1)];
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,32 @@
+#ifndef LPTC_CODERDOJO_LATENCY_STATS_H_
+#define LPTC_CODERDOJO_LATENCY_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Keeps every latency sample of a run, so percentiles are exact rather than
+// bucketed. At 30 frames per second a client adds under 2 000 samples a
+// minute. Not thread safe.
+class LatencyStats {
+ public:
+  LatencyStats();
+
+  void Add(int64_t sample);
+  void Merge(const LatencyStats& other);
+  void Clear();
+
+  size_t GetCount() const;
+  // Nearest-rank percentile, `percentile` in [0, 100]. 0 when empty.
+  int64_t GetPercentile(double percentile);
+
+ private:
+  std::vector<int64_t> samples;
+  bool sorted;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_LATENCY_STATS_H_
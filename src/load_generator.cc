@@ -0,0 +1,161 @@
+#include "load_generator.h"
+#include "../protocol/protocol_generated.h"
+
+#include <flatbuffers/flatbuffers.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace lptc_coderdojo {
+
+ClientReport::ClientReport()
+    : frames(0), bytes(0), errors(0), connected(false) {}
+
+LoadGenerator::LoadGenerator(const lptc_coderdojo::LoadConfig& _config)
+    : config(_config), measured_time(0) {
+  endpoint.clear_access_channels(websocketpp::log::alevel::all);
+  endpoint.clear_error_channels(websocketpp::log::elevel::all);
+  endpoint.init_asio();
+  endpoint.set_open_handler(
+      std::bind(&LoadGenerator::OnOpen, this, std::placeholders::_1));
+  endpoint.set_fail_handler(
+      std::bind(&LoadGenerator::OnFail, this, std::placeholders::_1));
+  endpoint.set_close_handler(
+      std::bind(&LoadGenerator::OnClose, this, std::placeholders::_1));
+  endpoint.set_message_handler(std::bind(&LoadGenerator::OnMessage, this,
+                                         std::placeholders::_1,
+                                         std::placeholders::_2));
+}
+
+std::vector<ClientReport> LoadGenerator::Run() {
+  std::string uri =
+      "ws://" + config.host + ":" + std::to_string(config.port) + "/";
+  for (int i = 0; i < config.clients; i++) {
+    websocketpp::lib::error_code ec;
+    AsioClient::connection_ptr conn = endpoint.get_connection(uri, ec);
+    if (ec) {
+      std::cerr << "!!!Error: cannot connect to " << uri << ": "
+                << ec.message() << std::endl;
+      return std::vector<ClientReport>();
+    }
+    clients.emplace_back(new Client());
+    clients.back()->hdl = conn->get_handle();
+    clients.back()->open = false;
+    clients_by_hdl[conn->get_handle()] = clients.back().get();
+    endpoint.connect(conn);
+  }
+
+  size_t io_threads = config.io_threads ? config.io_threads
+                                        : std::thread::hardware_concurrency();
+  std::vector<std::thread> io_pool;
+  for (size_t i = 0; i < std::max<size_t>(io_threads, 1); i++) {
+    io_pool.push_back(std::thread(&AsioClient::run, &endpoint));
+  }
+
+  std::this_thread::sleep_for(config.warmup);
+  for (const std::unique_ptr<Client>& client : clients) {
+    std::lock_guard<std::mutex> guard(client->lock);
+    size_t errors = client->report.errors;
+    client->report = ClientReport();
+    client->report.errors = errors;
+    client->report.connected = client->open;
+  }
+  std::chrono::steady_clock::time_point started =
+      std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(config.duration);
+
+  std::vector<ClientReport> reports;
+  for (const std::unique_ptr<Client>& client : clients) {
+    std::lock_guard<std::mutex> guard(client->lock);
+    reports.push_back(client->report);
+  }
+  measured_time = std::chrono::steady_clock::now() - started;
+
+  for (const std::unique_ptr<Client>& client : clients) {
+    websocketpp::lib::error_code ec;
+    endpoint.close(client->hdl, websocketpp::close::status::normal, "", ec);
+  }
+  for (std::thread& io_thread : io_pool) io_thread.join();
+  return reports;
+}
+
+std::chrono::steady_clock::duration LoadGenerator::GetMeasuredTime() const {
+  return measured_time;
+}
+
+LoadGenerator::Client* LoadGenerator::FindClient(
+    websocketpp::connection_hdl hdl) {
+  auto iter = clients_by_hdl.find(hdl);
+  return iter == clients_by_hdl.end() ? nullptr : iter->second;
+}
+
+void LoadGenerator::OnOpen(websocketpp::connection_hdl hdl) {
+  Client* client = FindClient(hdl);
+  if (!client) return;
+  {
+    std::lock_guard<std::mutex> guard(client->lock);
+    client->open = true;
+  }
+
+  for (const std::string& topic : config.topics) {
+    std::string command = "SUBSCRIBE " + topic;
+    if (!config.params.empty()) command += " " + config.params;
+    websocketpp::lib::error_code ec;
+    endpoint.send(hdl, command.data(), command.size(),
+                  websocketpp::frame::opcode::text, ec);
+  }
+}
+
+void LoadGenerator::OnFail(websocketpp::connection_hdl hdl) {
+  Client* client = FindClient(hdl);
+  if (!client) return;
+
+  std::lock_guard<std::mutex> guard(client->lock);
+  client->report.errors++;
+}
+
+// A client that drops out while measuring no longer counts as connected.
+void LoadGenerator::OnClose(websocketpp::connection_hdl hdl) {
+  Client* client = FindClient(hdl);
+  if (!client) return;
+
+  std::lock_guard<std::mutex> guard(client->lock);
+  client->open = false;
+  client->report.connected = false;
+}
+
+void LoadGenerator::OnMessage(websocketpp::connection_hdl hdl,
+                              AsioClient::message_ptr msg) {
+  int64_t received_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  Client* client = FindClient(hdl);
+  if (!client) return;
+
+  const std::string& payload = msg->get_payload();
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+  const protocol::Message* message =
+      protocol::VerifyMessageBuffer(verifier)
+          ? protocol::GetMessage(payload.data())
+          : nullptr;
+
+  std::lock_guard<std::mutex> guard(client->lock);
+  if (!message || message->type() == protocol::MessageType::Error) {
+    // Only the first error of each client, since they tend to repeat.
+    if (client->report.errors++ == 0) {
+      std::cerr << "!!!Error: server replied: "
+                << (message && message->error() ? message->error()->str()
+                                                 : "unreadable message")
+                << std::endl;
+    }
+    return;
+  }
+  client->report.frames++;
+  client->report.bytes += payload.size();
+  client->report.latency.Add(received_us -
+                             static_cast<int64_t>(message->timestamp()) * 1000);
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,76 @@
+#ifndef LPTC_CODERDOJO_LOAD_GENERATOR_H_
+#define LPTC_CODERDOJO_LOAD_GENERATOR_H_
+
+#include "config.h"
+#include "latency_stats.h"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+namespace lptc_coderdojo {
+
+typedef websocketpp::client<websocketpp::config::asio_client> AsioClient;
+
+// What one client received while the load generator was measuring, plus
+// the errors it got over the whole run, warm-up included. Latencies are
+// from a frame's capture on the server to its arrival, in microseconds.
+// Messages carry the capture time in whole milliseconds, so each sample
+// reads up to 1 ms high.
+struct ClientReport {
+  ClientReport();
+
+  size_t frames;
+  size_t bytes;
+  size_t errors;
+  bool connected;
+  lptc_coderdojo::LatencyStats latency;
+};
+
+// Opens `clients` websocket connections to a running server, subscribes
+// each to the configured topics and records what arrives. Meant to run on
+// the server's machine, whose clock stamps the frames.
+class LoadGenerator {
+ public:
+  explicit LoadGenerator(const lptc_coderdojo::LoadConfig& _config);
+
+  // Connects, waits out the warm-up, measures for the configured duration
+  // and disconnects. Returns one report per client, or none when the
+  // connections cannot be created.
+  std::vector<ClientReport> Run();
+  // The time Run actually measured for.
+  std::chrono::steady_clock::duration GetMeasuredTime() const;
+
+ private:
+  struct Client {
+    websocketpp::connection_hdl hdl;
+    std::mutex lock;
+    bool open;
+    ClientReport report;
+  };
+
+  Client* FindClient(websocketpp::connection_hdl hdl);
+  void OnOpen(websocketpp::connection_hdl hdl);
+  void OnFail(websocketpp::connection_hdl hdl);
+  void OnClose(websocketpp::connection_hdl hdl);
+  void OnMessage(websocketpp::connection_hdl hdl, AsioClient::message_ptr msg);
+
+  const lptc_coderdojo::LoadConfig config;
+  AsioClient endpoint;
+  std::vector<std::unique_ptr<Client>> clients;
+  // Filled before the first connection starts, read-only afterwards.
+  std::map<websocketpp::connection_hdl, Client*,
+           std::owner_less<websocketpp::connection_hdl>>
+      clients_by_hdl;
+  std::chrono::steady_clock::duration measured_time;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_LOAD_GENERATOR_H_
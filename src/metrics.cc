@@ -0,0 +1,213 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// Quotes a label value: backslashes, double quotes and newlines are escaped.
+std::string QuoteLabel(const std::string& value) {
+  std::string quoted = "\"";
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      quoted += '\\';
+      quoted += c;
+    } else if (c == '\n') {
+      quoted += "\\n";
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+void WriteFamilyHeader(std::ostringstream& out, const std::string& name,
+                       const std::string& type, const std::string& help) {
+  out << "# HELP " << name << " " << help << "\n"
+      << "# TYPE " << name << " " << type << "\n";
+}
+
+// Writes one sample of `name` per channel, as `value` gives it.
+template <typename Value>
+void WriteChannelFamily(
+    std::ostringstream& out,
+    const std::vector<lptc_coderdojo::ChannelReport>& reports,
+    const std::string& name, const std::string& type, const std::string& help,
+    Value value) {
+  WriteFamilyHeader(out, name, type, help);
+  for (const lptc_coderdojo::ChannelReport& report : reports) {
+    out << name << "{channel=" << QuoteLabel(report.topic) << "} "
+        << value(report) << "\n";
+  }
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+std::string PipelineStageName(PipelineStage stage) {
+  switch (stage) {
+    case PipelineStage::CAPTURE_TO_QUEUE:
+      return "capture_to_queue";
+    case PipelineStage::QUEUE_WAIT:
+      return "queue_wait";
+    case PipelineStage::TRANSFORM:
+      return "transform";
+    case PipelineStage::SERIALIZE:
+      return "serialize";
+    case PipelineStage::FAN_OUT:
+      return "fan_out";
+  }
+  return "unknown";
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), sum_ns(0) {
+  for (std::atomic<uint64_t>& bucket : buckets) bucket = 0;
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds elapsed) {
+  int64_t ns = std::max<int64_t>(0, elapsed.count());
+  // The first bound the sample does not exceed, as Prometheus' `le` reads.
+  size_t bucket =
+      std::lower_bound(kLatencyBoundsUs, kLatencyBoundsUs + kLatencyBounds,
+                       (ns + 999) / 1000) -
+      kLatencyBoundsUs;
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_ns.fetch_add(ns, std::memory_order_relaxed);
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetBucketCount(size_t bucket) const {
+  return buckets[bucket].load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+  return count.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetSum() const {
+  return std::chrono::nanoseconds(sum_ns.load(std::memory_order_relaxed));
+}
+
+PipelineMetrics::PipelineMetrics()
+    : sent_frames(0),
+      sent_bytes(0),
+      skipped_frames(0),
+      dropped_frames(0),
+      send_errors(0) {}
+
+void PipelineMetrics::RecordStage(PipelineStage stage,
+                                  std::chrono::nanoseconds elapsed) {
+  stages[static_cast<size_t>(stage)].Record(elapsed);
+}
+
+void PipelineMetrics::AddSentFrame(size_t bytes) {
+  sent_frames.fetch_add(1, std::memory_order_relaxed);
+  sent_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::AddSkippedFrame() {
+  skipped_frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::AddDroppedFrame() {
+  dropped_frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineMetrics::AddSendError() {
+  send_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+const LatencyHistogram& PipelineMetrics::GetStageLatency(
+    PipelineStage stage) const {
+  return stages[static_cast<size_t>(stage)];
+}
+
+size_t PipelineMetrics::GetSentFrames() const { return sent_frames.load(); }
+
+size_t PipelineMetrics::GetSentBytes() const { return sent_bytes.load(); }
+
+size_t PipelineMetrics::GetSkippedFrames() const {
+  return skipped_frames.load();
+}
+
+size_t PipelineMetrics::GetDroppedFrames() const {
+  return dropped_frames.load();
+}
+
+size_t PipelineMetrics::GetSendErrors() const { return send_errors.load(); }
+
+StageTimer::StageTimer(lptc_coderdojo::PipelineMetrics& _metrics)
+    : metrics(_metrics), last(std::chrono::steady_clock::now()) {}
+
+void StageTimer::Lap(PipelineStage stage) {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  metrics.RecordStage(stage, now - last);
+  last = now;
+}
+
+std::string FormatPrometheusMetrics(
+    const std::vector<lptc_coderdojo::ChannelReport>& reports) {
+  std::ostringstream out;
+
+  const std::string latency = "kinect_stage_latency_seconds";
+  WriteFamilyHeader(out, latency, "histogram",
+                    "Time frames spend in each pipeline stage.");
+  for (const ChannelReport& report : reports) {
+    for (size_t i = 0; i < kPipelineStages; i++) {
+      PipelineStage stage = static_cast<PipelineStage>(i);
+      const LatencyHistogram& histogram =
+          report.pipeline->GetStageLatency(stage);
+      std::string labels = "channel=" + QuoteLabel(report.topic) +
+                           ",stage=" + QuoteLabel(PipelineStageName(stage));
+
+      uint64_t cumulative = 0;
+      for (size_t bucket = 0; bucket <= kLatencyBounds; bucket++) {
+        cumulative += histogram.GetBucketCount(bucket);
+        out << latency << "_bucket{" << labels << ",le=\"";
+        if (bucket < kLatencyBounds) {
+          out << kLatencyBoundsUs[bucket] / 1e6;
+        } else {
+          out << "+Inf";
+        }
+        out << "\"} " << cumulative << "\n";
+      }
+      out << latency << "_sum{" << labels << "} "
+          << std::chrono::duration<double>(histogram.GetSum()).count() << "\n"
+          << latency << "_count{" << labels << "} " << cumulative << "\n";
+    }
+  }
+
+  WriteChannelFamily(out, reports, "kinect_channel_subscribers", "gauge",
+                     "Subscribers of the channel, in-process sinks included.",
+                     [](const ChannelReport& r) { return r.subscribers; });
+  WriteChannelFamily(
+      out, reports, "kinect_channel_queued_frames", "gauge",
+      "Frames waiting in the device queue that feeds the channel.",
+      [](const ChannelReport& r) { return r.queued_frames; });
+  WriteChannelFamily(
+      out, reports, "kinect_channel_dropped_frames_total", "counter",
+      "Frames lost before reaching the channel's subscribers.",
+      [](const ChannelReport& r) {
+        return r.dropped_frames + r.pipeline->GetDroppedFrames();
+      });
+  WriteChannelFamily(
+      out, reports, "kinect_channel_skipped_frames_total", "counter",
+      "Frames skipped for subscribers whose connection was backed up.",
+      [](const ChannelReport& r) { return r.pipeline->GetSkippedFrames(); });
+  WriteChannelFamily(
+      out, reports, "kinect_channel_sent_frames_total", "counter",
+      "Messages queued on subscriber connections.",
+      [](const ChannelReport& r) { return r.pipeline->GetSentFrames(); });
+  WriteChannelFamily(
+      out, reports, "kinect_channel_sent_bytes_total", "counter",
+      "Bytes queued on subscriber connections.",
+      [](const ChannelReport& r) { return r.pipeline->GetSentBytes(); });
+  WriteChannelFamily(
+      out, reports, "kinect_channel_send_errors_total", "counter",
+      "Messages that could not be queued on a subscriber connection.",
+      [](const ChannelReport& r) { return r.pipeline->GetSendErrors(); });
+  return out.str();
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,122 @@
+#ifndef LPTC_CODERDOJO_METRICS_H_
+#define LPTC_CODERDOJO_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// The steps a frame goes through between the device and the subscribers.
+// CAPTURE_TO_QUEUE runs from the frame's capture until the device hands it
+// to its queues, QUEUE_WAIT until a publisher takes it out. TRANSFORM is
+// the crop and downscale a variant asks for, SERIALIZE the pixel encoding
+// and message building, and FAN_OUT queuing the message for every
+// subscriber.
+enum class PipelineStage {
+  CAPTURE_TO_QUEUE,
+  QUEUE_WAIT,
+  TRANSFORM,
+  SERIALIZE,
+  FAN_OUT
+};
+const size_t kPipelineStages = 5;
+
+std::string PipelineStageName(PipelineStage stage);
+
+// Upper bounds of the latency histogram buckets, in microseconds. Samples
+// above the last bound go to an overflow bucket.
+const size_t kLatencyBounds = 14;
+const int64_t kLatencyBoundsUs[kLatencyBounds] = {
+    25,    50,    100,   250,    500,    1000,   2500,
+    5000,  10000, 25000, 50000, 100000, 250000, 1000000};
+
+// Counts samples into fixed buckets, so recording one is a bucket search
+// and three relaxed atomic increments, and never allocates or locks.
+// Readers may see a sample in the count before it shows in its bucket.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  // Negative durations, from wall clock adjustments, count as 0.
+  void Record(std::chrono::nanoseconds elapsed);
+  // Samples in bucket `bucket` alone, kLatencyBounds being the overflow.
+  uint64_t GetBucketCount(size_t bucket) const;
+  uint64_t GetCount() const;
+  std::chrono::nanoseconds GetSum() const;
+
+ private:
+  std::atomic<uint64_t> buckets[kLatencyBounds + 1];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum_ns;
+};
+
+// Stage timings and traffic counters of one channel. A channel's frames are
+// timed by its own publishing thread, plus the JPEG worker for video, so
+// pipelines never contend for each other's counters.
+class PipelineMetrics {
+ public:
+  PipelineMetrics();
+
+  void RecordStage(PipelineStage stage, std::chrono::nanoseconds elapsed);
+  // A message queued on a subscriber's connection.
+  void AddSentFrame(size_t bytes);
+  // A frame a subscriber missed because its connection was backed up.
+  void AddSkippedFrame();
+  // A frame that never reached the channel's subscribers, e.g. one the
+  // JPEG worker replaced with a newer one.
+  void AddDroppedFrame();
+  void AddSendError();
+
+  const LatencyHistogram& GetStageLatency(PipelineStage stage) const;
+  size_t GetSentFrames() const;
+  size_t GetSentBytes() const;
+  size_t GetSkippedFrames() const;
+  size_t GetDroppedFrames() const;
+  size_t GetSendErrors() const;
+
+ private:
+  LatencyHistogram stages[kPipelineStages];
+  std::atomic<size_t> sent_frames;
+  std::atomic<size_t> sent_bytes;
+  std::atomic<size_t> skipped_frames;
+  std::atomic<size_t> dropped_frames;
+  std::atomic<size_t> send_errors;
+};
+
+// Times consecutive stages: each Lap records the time since the timer was
+// started or last lapped.
+class StageTimer {
+ public:
+  explicit StageTimer(lptc_coderdojo::PipelineMetrics& _metrics);
+
+  void Lap(PipelineStage stage);
+
+ private:
+  lptc_coderdojo::PipelineMetrics& metrics;
+  std::chrono::steady_clock::time_point last;
+};
+
+// One channel's state when metrics are collected. `dropped_frames` covers
+// the device stream feeding the channel; the pipeline's own drops are added
+// to it.
+struct ChannelReport {
+  std::string topic;
+  size_t subscribers;
+  size_t queued_frames;
+  size_t dropped_frames;
+  const lptc_coderdojo::PipelineMetrics* pipeline;
+};
+
+// Content type of FormatPrometheusMetrics' output.
+const char kPrometheusContentType[] = "text/plain; version=0.0.4";
+
+// Renders the channels' metrics in the Prometheus text exposition format.
+std::string FormatPrometheusMetrics(
+    const std::vector<lptc_coderdojo::ChannelReport>& reports);
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_METRICS_H_
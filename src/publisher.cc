@@ -1,93 +1,571 @@
 #include "publisher.h"
 #include "../protocol/protocol_generated.h"
+#include "codec.h"
+#include "transform.h"
 
 #include <flatbuffers/flatbuffers.h>
+#include <algorithm>
 
 namespace {
 
-std::tuple<uint8_t*, size_t> SerializeMessage(
-    flatbuffers::FlatBufferBuilder& builder, const std::vector<uint8_t>& frame,
-    lptc_coderdojo::protocol::DataType type) {
-  flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data =
-      builder.CreateVector(frame);
+typedef flatbuffers::Offset<flatbuffers::Vector<uint8_t>> ByteVectorOffset;
+typedef flatbuffers::Offset<flatbuffers::Vector<uint16_t>> SampleVectorOffset;
 
+// Extra room reserved in each publisher's builder on top of the frame
+// payload, for the message tables and vtables.
+const size_t kMessageOverhead = 1024;
+
+typedef flatbuffers::Offset<lptc_coderdojo::protocol::DeviceData>
+    DeviceDataOffset;
+typedef flatbuffers::Offset<lptc_coderdojo::protocol::RgbdData>
+    RgbdDataOffset;
+
+// Reserves the frame payload inside the builder so the transform can write
+// straight into the serialized message.
+template <typename T>
+T* StartFrameData(flatbuffers::FlatBufferBuilder& builder, size_t len,
+                  flatbuffers::Offset<flatbuffers::Vector<T>>* data) {
+  T* payload;
+  *data = builder.CreateUninitializedVector(len, &payload);
+  return payload;
+}
+
+// Fewest rows worth handing to another thread.
+const size_t kMinBandRows = 32;
+// Packed 11-bit output is split on 8 pixel groups, which pack to 11 bytes.
+const size_t kMinBandGroups = 2048;
+
+// Video blocks are plainly averaged.
+void BoxDownscaleBand(const uint8_t* in, int width, int height, int stride,
+                      int channels, int scale, uint16_t, uint8_t* out) {
+  lptc_coderdojo::TransformBoxDownscale(in, width, height, stride, channels,
+                                        scale, out);
+}
+
+// Depth blocks average their valid samples only.
+void BoxDownscaleBand(const uint16_t* in, int width, int height, int stride,
+                      int, int scale, uint16_t no_reading, uint16_t* out) {
+  lptc_coderdojo::TransformDepthBoxDownscale(in, width, height, stride, scale,
+                                             no_reading, out);
+}
+
+// Runs the crop and downscale stages a variant asks for on a `width` x
+// `height` frame and updates the dimensions to the result's. Returns `in`
+// untouched when the variant wants the full frame, else the result in
+// `scratch`. Output rows are split into bands across `pool`. Depth frames
+// pass their format's `no_reading` value for the box filter to skip.
+template <typename T>
+const T* ReduceFrame(lptc_coderdojo::WorkerPool& pool, const T* in,
+                     int channels, const lptc_coderdojo::StreamVariant& variant,
+                     int* width, int* height, std::vector<T>& scratch,
+                     uint16_t no_reading = 0) {
+  int stride = *width;
+  lptc_coderdojo::Roi roi = {0, 0, *width, *height};
+  if (!variant.roi.IsEmpty()) {
+    roi.x = std::min(variant.roi.x, *width - 1);
+    roi.y = std::min(variant.roi.y, *height - 1);
+    roi.width = std::min(variant.roi.width, *width - roi.x);
+    roi.height = std::min(variant.roi.height, *height - roi.y);
+  }
+  int scale = std::min(variant.scale, std::min(roi.width, roi.height));
+  if (scale == 1 && roi.width == *width && roi.height == *height) return in;
+
+  const T* origin = in + ((size_t)roi.y * stride + roi.x) * channels;
+  bool box = variant.filter == lptc_coderdojo::ScaleFilter::BOX && scale > 1;
+  size_t out_width = roi.width / scale;
+  size_t out_height = roi.height / scale;
+  auto reduce_band = [&](size_t begin, size_t end) {
+    const T* band_in = origin + begin * scale * stride * channels;
+    T* band_out = scratch.data() + begin * out_width * channels;
+    int band_rows = (end - begin) * scale;
+    if (box) {
+      BoxDownscaleBand(band_in, roi.width, band_rows, stride, channels, scale,
+                       no_reading, band_out);
+    } else {
+      lptc_coderdojo::TransformDecimate(band_in, roi.width, band_rows, stride,
+                                        channels, scale, band_out);
+    }
+  };
+  pool.ParallelFor(out_height, std::max<size_t>(1, kMinBandRows / scale),
+                   reduce_band);
+  *width = out_width;
+  *height = out_height;
+  return scratch.data();
+}
+
+void ParallelDepthToPacked11(lptc_coderdojo::WorkerPool& pool,
+                             const uint16_t* depth, uint8_t* packed,
+                             size_t pixels) {
+  auto pack_band = [&](size_t begin, size_t end) {
+    size_t last = std::min(end * 8, pixels);
+    lptc_coderdojo::TransformDepthToPacked11(
+        depth + begin * 8, packed + begin * 11, last - begin * 8);
+  };
+  pool.ParallelFor((pixels + 7) / 8, kMinBandGroups, pack_band);
+}
+
+void ParallelDepthToRgba(lptc_coderdojo::WorkerPool& pool,
+                         const uint16_t* depth, uint8_t* rgba, int width,
+                         int height) {
+  pool.ParallelFor(height, kMinBandRows, [&](size_t begin, size_t end) {
+    lptc_coderdojo::TransformDepthToRgba(
+        depth + begin * width, rgba + begin * width * 4, (end - begin) * width);
+  });
+}
+
+// `channels` is 3 for RGB video and 1 for IR.
+void ParallelVideoToRgba(lptc_coderdojo::WorkerPool& pool,
+                         const uint8_t* video, int channels, uint8_t* rgba,
+                         int width, int height) {
+  pool.ParallelFor(height, kMinBandRows, [&](size_t begin, size_t end) {
+    const uint8_t* band_in = video + begin * width * channels;
+    uint8_t* band_out = rgba + begin * width * 4;
+    if (channels == 1) {
+      lptc_coderdojo::TransformGreyToRgba(band_in, band_out,
+                                          (end - begin) * width);
+    } else {
+      lptc_coderdojo::TransformRgbToRgba(band_in, band_out,
+                                         (end - begin) * width);
+    }
+  });
+}
+
+DeviceDataOffset BuildDeviceData(flatbuffers::FlatBufferBuilder& builder,
+                                 lptc_coderdojo::protocol::DataType type,
+                                 int width, int height,
+                                 uint32_t device_timestamp,
+                                 ByteVectorOffset bytes,
+                                 SampleVectorOffset samples = 0) {
   lptc_coderdojo::protocol::DeviceDataBuilder dev_data_builder(builder);
   dev_data_builder.add_type(type);
+  dev_data_builder.add_width(width);
+  dev_data_builder.add_height(height);
+  dev_data_builder.add_device_timestamp(device_timestamp);
+
+  switch (type) {
+    case lptc_coderdojo::protocol::DataType::Depth:
+    case lptc_coderdojo::protocol::DataType::DepthPacked11:
+    case lptc_coderdojo::protocol::DataType::DepthRvl:
+      dev_data_builder.add_depth(bytes);
+      break;
+    case lptc_coderdojo::protocol::DataType::Video:
+    case lptc_coderdojo::protocol::DataType::VideoRgb:
+    case lptc_coderdojo::protocol::DataType::VideoJpeg:
+      dev_data_builder.add_video(bytes);
+      break;
+    case lptc_coderdojo::protocol::DataType::DepthRaw16:
+      dev_data_builder.add_depth_raw(samples);
+      break;
+  }
+  return dev_data_builder.Finish();
+}
+
+// Appends a depth frame in the form `encoding` asks for. `compressed` must
+// hold GetRvlMaxSize(width * height) bytes.
+DeviceDataOffset AddDepthData(lptc_coderdojo::WorkerPool& pool,
+                              flatbuffers::FlatBufferBuilder& builder,
+                              const uint16_t* depth, int width, int height,
+                              uint32_t device_timestamp,
+                              lptc_coderdojo::Encoding encoding,
+                              std::vector<uint8_t>& compressed) {
+  typedef lptc_coderdojo::protocol::DataType DataType;
+  int rect_size = width * height;
+
+  if (encoding == lptc_coderdojo::Encoding::RAW16) {
+    SampleVectorOffset samples;
+    uint16_t* raw = StartFrameData(builder, rect_size, &samples);
+    std::copy(depth, depth + rect_size, raw);
+    return BuildDeviceData(builder, DataType::DepthRaw16, width, height,
+                           device_timestamp, 0, samples);
+  }
 
-  if (type == lptc_coderdojo::protocol::DataType::Depth) {
-    dev_data_builder.add_depth(data);
-  } else if (type == lptc_coderdojo::protocol::DataType::Video) {
-    dev_data_builder.add_video(data);
+  ByteVectorOffset data;
+  if (encoding == lptc_coderdojo::Encoding::PACKED11) {
+    uint8_t* packed = StartFrameData(
+        builder, lptc_coderdojo::GetPacked11Size(rect_size), &data);
+    ParallelDepthToPacked11(pool, depth, packed, rect_size);
+    return BuildDeviceData(builder, DataType::DepthPacked11, width, height,
+                           device_timestamp, data);
+  } else if (encoding == lptc_coderdojo::Encoding::RVL) {
+    // The encoded size is only known afterwards, so encode aside and copy
+    // the much smaller result into the builder.
+    size_t len = lptc_coderdojo::EncodeRvl(depth, rect_size, compressed.data());
+    data = builder.CreateVector(compressed.data(), len);
+    return BuildDeviceData(builder, DataType::DepthRvl, width, height,
+                           device_timestamp, data);
   }
-  flatbuffers::Offset<lptc_coderdojo::protocol::DeviceData> dev_data =
-      dev_data_builder.Finish();
-  builder.Finish(dev_data);
 
+  uint8_t* rgba = StartFrameData(builder, rect_size * 4, &data);
+  ParallelDepthToRgba(pool, depth, rgba, width, height);
+  return BuildDeviceData(builder, DataType::Depth, width, height,
+                         device_timestamp, data);
+}
+
+// Appends a video frame as RGB for Encoding::RGB, else as RGBA.
+DeviceDataOffset AddVideoData(lptc_coderdojo::WorkerPool& pool,
+                              flatbuffers::FlatBufferBuilder& builder,
+                              const uint8_t* video, int channels, int width,
+                              int height, uint32_t device_timestamp,
+                              lptc_coderdojo::Encoding encoding) {
+  typedef lptc_coderdojo::protocol::DataType DataType;
+  int rect_size = width * height;
+  ByteVectorOffset data;
+
+  if (encoding == lptc_coderdojo::Encoding::RGB) {
+    uint8_t* rgb = StartFrameData(builder, rect_size * 3, &data);
+    if (channels == 1) {
+      lptc_coderdojo::TransformGreyToRgb(video, rgb, rect_size);
+    } else {
+      std::copy(video, video + rect_size * 3, rgb);
+    }
+    return BuildDeviceData(builder, DataType::VideoRgb, width, height,
+                           device_timestamp, data);
+  }
+
+  uint8_t* rgba = StartFrameData(builder, rect_size * 4, &data);
+  ParallelVideoToRgba(pool, video, channels, rgba, width, height);
+  return BuildDeviceData(builder, DataType::Video, width, height,
+                         device_timestamp, data);
+}
+
+// Records how long a frame took to reach the device's queues and how long
+// it then waited for the publisher.
+template <typename T>
+void RecordQueueStages(lptc_coderdojo::PipelineMetrics& metrics,
+                       const lptc_coderdojo::Frame<T>& frame) {
+  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+  metrics.RecordStage(lptc_coderdojo::PipelineStage::CAPTURE_TO_QUEUE,
+                      frame.queued_time - frame.capture_time);
+  metrics.RecordStage(lptc_coderdojo::PipelineStage::QUEUE_WAIT,
+                      now - frame.queued_time);
+}
+
+// Stamps the message with the frame's capture time, so consumers see when
+// the frame was taken rather than when it was sent.
+void FinishMessage(flatbuffers::FlatBufferBuilder& builder,
+                   std::chrono::system_clock::time_point capture_time,
+                   DeviceDataOffset data, RgbdDataOffset rgbd = 0) {
   lptc_coderdojo::protocol::MessageBuilder msg_builder(builder);
-  msg_builder.add_type(lptc_coderdojo::protocol::MessageType::DeviceData);
-  msg_builder.add_data(dev_data);
+  msg_builder.add_type(
+      rgbd.o ? lptc_coderdojo::protocol::MessageType::RgbdData
+             : lptc_coderdojo::protocol::MessageType::DeviceData);
+  msg_builder.add_data(data);
+  msg_builder.add_rgbd(rgbd);
   msg_builder.add_timestamp(
       std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::system_clock::now().time_since_epoch())
+          capture_time.time_since_epoch())
           .count());
   flatbuffers::Offset<lptc_coderdojo::protocol::Message> msg =
       msg_builder.Finish();
   builder.Finish(msg);
-
-  return std::make_tuple(builder.GetBufferPointer(), builder.GetSize());
 }
 
 }  // namespace
 
 namespace lptc_coderdojo {
 
-DepthDataPublisher::DepthDataPublisher(lptc_coderdojo::KinectDevice& _device)
-    : device(_device), frame(_device.GetDepthFrameRectSize() * 4) {}
+void Publisher::SelectDueVariants(lptc_coderdojo::VariantList& variants,
+                                  std::chrono::steady_clock::time_point now) {
+  // Forget variants nobody asks for any more, so clients cycling through
+  // parameters cannot grow the map without bound.
+  std::map<StreamVariant, std::chrono::steady_clock::time_point>::iterator
+      due_iter = next_due.begin();
+  while (due_iter != next_due.end()) {
+    if (std::find(variants.begin(), variants.end(), due_iter->first) ==
+        variants.end()) {
+      due_iter = next_due.erase(due_iter);
+    } else {
+      ++due_iter;
+    }
+  }
+
+  VariantList::iterator iter = variants.begin();
+  while (iter != variants.end()) {
+    if (iter->fps == 0) {
+      ++iter;
+      continue;
+    }
 
-void DepthDataPublisher::PublishNewData(lptc_coderdojo::Channel* channel) {
-  if (!device.GetNextDepthFrame(buf)) return;
+    std::chrono::steady_clock::duration interval =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::seconds(1)) /
+        iter->fps;
+    std::chrono::steady_clock::time_point& due = next_due[*iter];
+    if (now + kPacingSlack < due) {
+      iter = variants.erase(iter);
+      continue;
+    }
 
-  Transform();
+    due += interval;
+    if (due < now) due = now + interval;
+    ++iter;
+  }
+}
+
+DepthDataPublisher::DepthDataPublisher(lptc_coderdojo::KinectDevice& _device,
+                                       lptc_coderdojo::WorkerPool& _pool)
+    : device(_device),
+      pool(_pool),
+      scaled(_device.GetDepthFrameRectSize()),
+      compressed(GetRvlMaxSize(_device.GetDepthFrameRectSize())),
+      builder(_device.GetDepthFrameRectSize() * 4 + kMessageOverhead) {}
 
-  flatbuffers::FlatBufferBuilder builder;
-  SerializeMessage(builder, frame, lptc_coderdojo::protocol::DataType::Depth);
-  channel->Publish(builder.GetBufferPointer(), builder.GetSize());
+lptc_coderdojo::EncodingList DepthDataPublisher::GetSupportedEncodings(
+    lptc_coderdojo::DepthFormat format) {
+  if (format != DepthFormat::RAW11) return {Encoding::RGBA, Encoding::RAW16};
+  return {Encoding::RGBA, Encoding::RAW16, Encoding::PACKED11, Encoding::RVL};
 }
 
-void DepthDataPublisher::Transform() {
-  // resize to an RGBA frame;
-  int rect_size = device.GetDepthFrameRectSize();
-  for (int i = 0; i < rect_size; i++) {
-    uint8_t val = (uint8_t)buf[i];
-    frame[i * 4] = 255 - val;
-    frame[i * 4 + 1] = 255 - val;
-    frame[i * 4 + 2] = 255 - val;
-    frame[i * 4 + 3] = 255;
+bool DepthDataPublisher::PublishNewData(lptc_coderdojo::Channel* channel) {
+  if (!device.GetNextDepthFrame(buf)) return false;
+  RecordQueueStages(channel->GetMetrics(), *buf);
+
+  channel->GetActiveVariants(variants);
+  SelectDueVariants(variants, std::chrono::steady_clock::now());
+  for (const StreamVariant& variant : variants) {
+    Serialize(variant, channel->GetMetrics());
+    channel->Publish(variant, builder.GetBufferPointer(), builder.GetSize());
   }
+  return true;
 }
 
-VideoDataPublisher::VideoDataPublisher(lptc_coderdojo::KinectDevice& _device)
-    : device(_device), frame(_device.GetVideoFrameRectSize() * 4) {}
+void DepthDataPublisher::StartStream() { device.StartDepth(); }
 
-void VideoDataPublisher::PublishNewData(lptc_coderdojo::Channel* channel) {
-  if (!device.GetNextVideoFrame(buf)) return;
+void DepthDataPublisher::StopStream() { device.StopDepth(); }
 
-  Transform();
+void DepthDataPublisher::Serialize(const StreamVariant& variant,
+                                   PipelineMetrics& metrics) {
+  StageTimer timer(metrics);
+  int width = device.GetDepthFrameWidth();
+  int height = device.GetDepthFrameHeight();
+  const uint16_t* depth =
+      ReduceFrame(pool, buf->data.data(), 1, variant, &width, &height, scaled,
+                  GetDepthNoReading(device.GetDepthFormat()));
+  timer.Lap(PipelineStage::TRANSFORM);
 
-  flatbuffers::FlatBufferBuilder builder;
-  SerializeMessage(builder, frame, lptc_coderdojo::protocol::DataType::Video);
-  channel->Publish(builder.GetBufferPointer(), builder.GetSize());
+  builder.Clear();
+  DeviceDataOffset data = AddDepthData(pool, builder, depth, width, height,
+                                       buf->timestamp, variant.encoding,
+                                       compressed);
+  FinishMessage(builder, buf->capture_time, data);
+  timer.Lap(PipelineStage::SERIALIZE);
 }
 
-void VideoDataPublisher::Transform() {
-  // resize to an RGBA frame;
-  int rect_size = device.GetVideoFrameRectSize();
-  for (int i = 0; i < rect_size; i++) {
-    frame[i * 4] = buf[i * 3];
-    frame[i * 4 + 1] = buf[i * 3 + 1];
-    frame[i * 4 + 2] = buf[i * 3 + 2];
-    frame[i * 4 + 3] = 255;
+JpegVideoWorker::JpegVideoWorker(lptc_coderdojo::KinectDevice& _device,
+                                 lptc_coderdojo::WorkerPool& _pool)
+    : device(_device),
+      pool(_pool),
+      channels(GetVideoChannels(_device.GetVideoFormat())),
+      pending_channel(NULL),
+      stopping(false),
+      dropped_frames(0),
+      scaled(_device.GetVideoFrameRectSize() * channels),
+      builder(_device.GetVideoFrameRectSize() + kMessageOverhead),
+      worker(&JpegVideoWorker::Run, this) {}
+
+JpegVideoWorker::~JpegVideoWorker() {
+  {
+    std::lock_guard<std::mutex> guard(slot_lock);
+    stopping = true;
   }
+  slot_cond.notify_one();
+  worker.join();
+}
+
+void JpegVideoWorker::Submit(lptc_coderdojo::Channel* channel,
+                             const lptc_coderdojo::VideoFramePtr& frame,
+                             const lptc_coderdojo::VariantList& variants) {
+  {
+    std::lock_guard<std::mutex> guard(slot_lock);
+    if (pending_frame) {
+      dropped_frames++;
+      pending_channel->GetMetrics().AddDroppedFrame();
+    }
+    pending_channel = channel;
+    pending_frame = frame;
+    pending_variants.assign(variants.begin(), variants.end());
+  }
+  slot_cond.notify_one();
+}
+
+size_t JpegVideoWorker::GetDroppedFrames() const {
+  return dropped_frames.load();
+}
+
+void JpegVideoWorker::Run() {
+  while (true) {
+    lptc_coderdojo::Channel* channel;
+    {
+      std::unique_lock<std::mutex> lock(slot_lock);
+      slot_cond.wait(lock, [this] { return stopping || pending_frame; });
+      if (stopping) return;
+
+      channel = pending_channel;
+      frame.swap(pending_frame);
+      variants.swap(pending_variants);
+    }
+
+    for (const StreamVariant& variant : variants) {
+      if (!Serialize(variant, channel->GetMetrics())) continue;
+      channel->Publish(variant, builder.GetBufferPointer(), builder.GetSize());
+    }
+    // Hand the frame back to the device's pool.
+    frame.reset();
+  }
+}
+
+bool JpegVideoWorker::Serialize(const StreamVariant& variant,
+                                PipelineMetrics& metrics) {
+  StageTimer timer(metrics);
+  int width = device.GetVideoFrameWidth();
+  int height = device.GetVideoFrameHeight();
+  const uint8_t* video =
+      ReduceFrame(pool, frame->data.data(), channels, variant, &width,
+                  &height, scaled);
+  timer.Lap(PipelineStage::TRANSFORM);
+
+  if (!encoder.Encode(video, width, height, channels, variant.quality,
+                      &compressed))
+    return false;
+
+  builder.Clear();
+  ByteVectorOffset bytes =
+      builder.CreateVector(compressed.data(), compressed.size());
+  DeviceDataOffset data =
+      BuildDeviceData(builder, protocol::DataType::VideoJpeg, width, height,
+                      frame->timestamp, bytes);
+  FinishMessage(builder, frame->capture_time, data);
+  timer.Lap(PipelineStage::SERIALIZE);
+  return true;
+}
+
+VideoDataPublisher::VideoDataPublisher(lptc_coderdojo::KinectDevice& _device,
+                                       lptc_coderdojo::WorkerPool& _pool)
+    : device(_device),
+      pool(_pool),
+      channels(GetVideoChannels(_device.GetVideoFormat())),
+      scaled(_device.GetVideoFrameRectSize() * channels),
+      builder(_device.GetVideoFrameRectSize() * 4 + kMessageOverhead),
+      jpeg_worker(_device, _pool) {}
+
+lptc_coderdojo::EncodingList VideoDataPublisher::GetSupportedEncodings() {
+  return {Encoding::RGBA, Encoding::RGB, Encoding::JPEG};
+}
+
+bool VideoDataPublisher::PublishNewData(lptc_coderdojo::Channel* channel) {
+  if (!device.GetNextVideoFrame(buf)) return false;
+  RecordQueueStages(channel->GetMetrics(), *buf);
+
+  channel->GetActiveVariants(variants);
+  SelectDueVariants(variants, std::chrono::steady_clock::now());
+
+  jpeg_variants.clear();
+  for (const StreamVariant& variant : variants) {
+    if (variant.encoding == Encoding::JPEG) {
+      jpeg_variants.push_back(variant);
+      continue;
+    }
+    Serialize(variant, channel->GetMetrics());
+    channel->Publish(variant, builder.GetBufferPointer(), builder.GetSize());
+  }
+  if (!jpeg_variants.empty()) jpeg_worker.Submit(channel, buf, jpeg_variants);
+  return true;
+}
+
+void VideoDataPublisher::StartStream() { device.StartVideo(); }
+
+void VideoDataPublisher::StopStream() { device.StopVideo(); }
+
+void VideoDataPublisher::Serialize(const StreamVariant& variant,
+                                   PipelineMetrics& metrics) {
+  StageTimer timer(metrics);
+  int width = device.GetVideoFrameWidth();
+  int height = device.GetVideoFrameHeight();
+  const uint8_t* video =
+      ReduceFrame(pool, buf->data.data(), channels, variant, &width, &height,
+                  scaled);
+  timer.Lap(PipelineStage::TRANSFORM);
+
+  builder.Clear();
+  DeviceDataOffset data =
+      AddVideoData(pool, builder, video, channels, width, height,
+                   buf->timestamp, variant.encoding);
+  FinishMessage(builder, buf->capture_time, data);
+  timer.Lap(PipelineStage::SERIALIZE);
+}
+
+RgbdDataPublisher::RgbdDataPublisher(lptc_coderdojo::KinectDevice& _device,
+                                     lptc_coderdojo::WorkerPool& _pool)
+    : device(_device),
+      pool(_pool),
+      channels(GetVideoChannels(_device.GetVideoFormat())),
+      scaled_depth(_device.GetDepthFrameRectSize()),
+      scaled_video(_device.GetVideoFrameRectSize() * channels),
+      compressed(GetRvlMaxSize(_device.GetDepthFrameRectSize())),
+      builder((_device.GetDepthFrameRectSize() +
+               _device.GetVideoFrameRectSize()) *
+                  4 +
+              kMessageOverhead) {}
+
+lptc_coderdojo::EncodingList RgbdDataPublisher::GetSupportedEncodings(
+    lptc_coderdojo::DepthFormat format) {
+  if (format != DepthFormat::RAW11) return {Encoding::RGBA, Encoding::RAW16};
+  return {Encoding::RGBA, Encoding::RAW16, Encoding::RVL};
+}
+
+bool RgbdDataPublisher::PublishNewData(lptc_coderdojo::Channel* channel) {
+  if (!device.GetNextRgbdFrame(buf)) return false;
+  // The depth frame's wait includes the wait for its video partner.
+  RecordQueueStages(channel->GetMetrics(), *buf.depth);
+
+  channel->GetActiveVariants(variants);
+  SelectDueVariants(variants, std::chrono::steady_clock::now());
+  for (const StreamVariant& variant : variants) {
+    Serialize(variant, channel->GetMetrics());
+    channel->Publish(variant, builder.GetBufferPointer(), builder.GetSize());
+  }
+  return true;
+}
+
+void RgbdDataPublisher::StartStream() { device.StartRgbd(); }
+
+void RgbdDataPublisher::StopStream() { device.StopRgbd(); }
+
+void RgbdDataPublisher::Serialize(const StreamVariant& variant,
+                                  PipelineMetrics& metrics) {
+  StageTimer timer(metrics);
+  int depth_width = device.GetDepthFrameWidth();
+  int depth_height = device.GetDepthFrameHeight();
+  const uint16_t* depth =
+      ReduceFrame(pool, buf.depth->data.data(), 1, variant, &depth_width,
+                  &depth_height, scaled_depth,
+                  GetDepthNoReading(device.GetDepthFormat()));
+  int video_width = device.GetVideoFrameWidth();
+  int video_height = device.GetVideoFrameHeight();
+  const uint8_t* video =
+      ReduceFrame(pool, buf.video->data.data(), channels, variant,
+                  &video_width, &video_height, scaled_video);
+  timer.Lap(PipelineStage::TRANSFORM);
+
+  builder.Clear();
+  DeviceDataOffset depth_data =
+      AddDepthData(pool, builder, depth, depth_width, depth_height,
+                   buf.depth->timestamp, variant.encoding, compressed);
+  DeviceDataOffset video_data = AddVideoData(
+      pool, builder, video, channels, video_width, video_height,
+      buf.video->timestamp,
+      variant.encoding == Encoding::RGBA ? Encoding::RGBA : Encoding::RGB);
+
+  protocol::RgbdDataBuilder rgbd_builder(builder);
+  rgbd_builder.add_depth(depth_data);
+  rgbd_builder.add_video(video_data);
+  rgbd_builder.add_skew(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          buf.video->capture_time - buf.depth->capture_time)
+          .count());
+  RgbdDataOffset rgbd = rgbd_builder.Finish();
+  FinishMessage(builder, buf.depth->capture_time, 0, rgbd);
+  timer.Lap(PipelineStage::SERIALIZE);
 }
 
-}  // namespace lptc_coderdojo
\ No newline at end of file
+}  // namespace lptc_coderdojo
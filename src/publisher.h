@@ -2,7 +2,20 @@
 #define LPTC_CODERDOJO_PUBLISHER_H_
 
 #include "channel.h"
+#include "codec.h"
 #include "device.h"
+#include "encoding.h"
+#include "stream_variant.h"
+#include "worker_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <flatbuffers/flatbuffers.h>
 
 namespace lptc_coderdojo {
 
@@ -11,35 +24,149 @@ class Publisher {
   Publisher() = default;
   virtual ~Publisher() = default;
 
-  virtual void PublishNewData(lptc_coderdojo::Channel* channel) = 0;
+  // Waits for the next frame and publishes it to the channel's subscribers.
+  // Returns false once the device has shut down.
+  virtual bool PublishNewData(lptc_coderdojo::Channel* channel) = 0;
+  // Start and stop the device stream this publisher reads from.
+  virtual void StartStream() = 0;
+  virtual void StopStream() = 0;
+
+ protected:
+  // Drops the variants whose fps limit says they are not due for `now`.
+  // `variants` must hold every active variant, as pacing state is kept for
+  // those only.
+  void SelectDueVariants(lptc_coderdojo::VariantList& variants,
+                         std::chrono::steady_clock::time_point now);
+
+ private:
+  std::map<lptc_coderdojo::StreamVariant,
+           std::chrono::steady_clock::time_point>
+      next_due;
 };
 
 class DepthDataPublisher : public Publisher {
  public:
-  DepthDataPublisher(lptc_coderdojo::KinectDevice& _device);
+  DepthDataPublisher(lptc_coderdojo::KinectDevice& _device,
+                     lptc_coderdojo::WorkerPool& _pool);
+
+  // Packed 11-bit and RVL frames assume the 11-bit format's value range and
+  // "no reading" value, so millimetre formats only offer RGBA and RAW16.
+  static lptc_coderdojo::EncodingList GetSupportedEncodings(
+      lptc_coderdojo::DepthFormat format);
 
-  void PublishNewData(lptc_coderdojo::Channel* channel);
-  void Transform();
+  bool PublishNewData(lptc_coderdojo::Channel* channel);
+  void StartStream();
+  void StopStream();
+  void Serialize(const lptc_coderdojo::StreamVariant& variant,
+                 lptc_coderdojo::PipelineMetrics& metrics);
 
  private:
   lptc_coderdojo::KinectDevice& device;
-  std::vector<uint16_t> buf;
-  std::vector<uint8_t> frame;
+  lptc_coderdojo::WorkerPool& pool;
+  lptc_coderdojo::DepthFramePtr buf;
+  std::vector<uint16_t> scaled;
+  std::vector<uint8_t> compressed;
+  flatbuffers::FlatBufferBuilder builder;
+  lptc_coderdojo::VariantList variants;
+};
+
+// Compresses JPEG video variants on its own thread so the publishing loop is
+// never held up by them. Only the newest submitted frame waits: one still
+// waiting when the next arrives is dropped for the JPEG subscribers.
+class JpegVideoWorker {
+ public:
+  JpegVideoWorker(lptc_coderdojo::KinectDevice& _device,
+                  lptc_coderdojo::WorkerPool& _pool);
+  ~JpegVideoWorker();
+
+  void Submit(lptc_coderdojo::Channel* channel,
+              const lptc_coderdojo::VideoFramePtr& frame,
+              const lptc_coderdojo::VariantList& variants);
+  size_t GetDroppedFrames() const;
+
+ private:
+  void Run();
+  bool Serialize(const lptc_coderdojo::StreamVariant& variant,
+                 lptc_coderdojo::PipelineMetrics& metrics);
+
+  lptc_coderdojo::KinectDevice& device;
+  lptc_coderdojo::WorkerPool& pool;
+  const int channels;
+
+  std::mutex slot_lock;
+  std::condition_variable slot_cond;
+  lptc_coderdojo::Channel* pending_channel;
+  lptc_coderdojo::VideoFramePtr pending_frame;
+  lptc_coderdojo::VariantList pending_variants;
+  bool stopping;
+  std::atomic<size_t> dropped_frames;
+
+  lptc_coderdojo::VideoFramePtr frame;
+  lptc_coderdojo::VariantList variants;
+  std::vector<uint8_t> scaled;
+  std::vector<uint8_t> compressed;
+  lptc_coderdojo::JpegEncoder encoder;
+  flatbuffers::FlatBufferBuilder builder;
+  std::thread worker;
 };
 
 class VideoDataPublisher : public Publisher {
  public:
-  VideoDataPublisher(lptc_coderdojo::KinectDevice& _device);
+  VideoDataPublisher(lptc_coderdojo::KinectDevice& _device,
+                     lptc_coderdojo::WorkerPool& _pool);
+
+  static lptc_coderdojo::EncodingList GetSupportedEncodings();
+
+  bool PublishNewData(lptc_coderdojo::Channel* channel);
+  void StartStream();
+  void StopStream();
+  void Serialize(const lptc_coderdojo::StreamVariant& variant,
+                 lptc_coderdojo::PipelineMetrics& metrics);
+
+ private:
+  lptc_coderdojo::KinectDevice& device;
+  lptc_coderdojo::WorkerPool& pool;
+  // Samples per pixel: 3 for RGB video, 1 for IR.
+  const int channels;
+  lptc_coderdojo::VideoFramePtr buf;
+  std::vector<uint8_t> scaled;
+  flatbuffers::FlatBufferBuilder builder;
+  lptc_coderdojo::VariantList variants;
+  lptc_coderdojo::VariantList jpeg_variants;
+  JpegVideoWorker jpeg_worker;
+};
+
+// Publishes depth frames paired with the video frame captured closest to
+// them, both in one message. The depth half is encoded as the variant asks;
+// the video half goes as RGBA for RGBA variants and as RGB otherwise. Crop
+// and scale apply to each half in its own pixel coordinates, so they only
+// line up when both streams have the same resolution.
+class RgbdDataPublisher : public Publisher {
+ public:
+  RgbdDataPublisher(lptc_coderdojo::KinectDevice& _device,
+                    lptc_coderdojo::WorkerPool& _pool);
+
+  static lptc_coderdojo::EncodingList GetSupportedEncodings(
+      lptc_coderdojo::DepthFormat format);
 
-  void PublishNewData(lptc_coderdojo::Channel* channel);
-  void Transform();
+  bool PublishNewData(lptc_coderdojo::Channel* channel);
+  void StartStream();
+  void StopStream();
+  void Serialize(const lptc_coderdojo::StreamVariant& variant,
+                 lptc_coderdojo::PipelineMetrics& metrics);
 
  private:
   lptc_coderdojo::KinectDevice& device;
-  std::vector<uint8_t> buf;
-  std::vector<uint8_t> frame;
+  lptc_coderdojo::WorkerPool& pool;
+  const int channels;
+  lptc_coderdojo::RgbdFrame buf;
+  std::vector<uint16_t> scaled_depth;
+  std::vector<uint8_t> scaled_video;
+  std::vector<uint8_t> compressed;
+  flatbuffers::FlatBufferBuilder builder;
+  lptc_coderdojo::VariantList variants;
 };
 
 }  // namespace lptc_coderdojo
 
-#endif  // LPTC_CODERDOJO_PUBLISHER_H_
\ No newline at end of file
+#endif  // LPTC_CODERDOJO_PUBLISHER_H_
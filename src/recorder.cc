@@ -0,0 +1,226 @@
+#include "recorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+size_t RoundUpToPage(size_t size) {
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return (size + page - 1) / page * page;
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+FrameRecorder::FrameRecorder(const std::string& _path, size_t _segment_size,
+                             size_t buffer_size)
+    : path(_path),
+      segment_size(RoundUpToPage(_segment_size)),
+      fd(open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)),
+      segment(nullptr),
+      segment_offset(0),
+      segment_used(0),
+      failed(false),
+      buffer(buffer_size),
+      read_pos(0),
+      write_pos(0),
+      buffered(0),
+      closing(false),
+      recorded_frames(0),
+      dropped_frames(0) {
+  if (fd < 0) {
+    throw std::runtime_error("cannot create capture file `" + path +
+                             "`: " + std::strerror(errno));
+  }
+
+  CaptureHeader header = {kCaptureMagic, kCaptureVersion,
+                          RoundUpToPage(sizeof(CaptureHeader)), segment_size,
+                          0, 0};
+  if (pwrite(fd, &header, sizeof(header), 0) !=
+      static_cast<ssize_t>(sizeof(header))) {
+    std::string error = std::strerror(errno);
+    close(fd);
+    throw std::runtime_error("cannot write capture file `" + path +
+                             "`: " + error);
+  }
+  writer = std::thread(&FrameRecorder::WriteRecords, this);
+}
+
+FrameRecorder::~FrameRecorder() { Close(); }
+
+bool FrameRecorder::Record(CaptureRecord record, const void* payload,
+                           size_t len) {
+  size_t size = GetCaptureRecordSize(len);
+  record.magic = kCaptureRecordMagic;
+  record.payload_size = static_cast<uint32_t>(len);
+
+  {
+    std::lock_guard<std::mutex> guard(buffer_lock);
+    if (buffered == 0) read_pos = write_pos = 0;
+
+    size_t pos = write_pos;
+    size_t waste = 0;
+    if (pos + size > buffer.size()) {
+      waste = buffer.size() - pos;
+      pos = 0;
+    }
+    if (closing || size > segment_size ||
+        buffered + waste + size > buffer.size()) {
+      dropped_frames++;
+      return false;
+    }
+
+    if (waste >= sizeof(CaptureRecord)) {
+      std::memset(&buffer[write_pos], 0, sizeof(record.magic));
+    }
+    uint8_t* out = &buffer[pos];
+    std::memcpy(out, &record, sizeof(record));
+    std::memcpy(out + sizeof(record), payload, len);
+    std::memset(out + sizeof(record) + len, 0, size - sizeof(record) - len);
+    write_pos = pos + size;
+    buffered += waste + size;
+  }
+  buffer_cond.notify_one();
+  return true;
+}
+
+void FrameRecorder::Close() {
+  {
+    std::lock_guard<std::mutex> guard(buffer_lock);
+    if (closing) return;
+    closing = true;
+  }
+  buffer_cond.notify_one();
+  writer.join();
+
+  WriteIndex();
+  close(fd);
+}
+
+const std::string& FrameRecorder::GetPath() const { return path; }
+
+size_t FrameRecorder::GetRecordedFrames() const {
+  return recorded_frames.load();
+}
+
+size_t FrameRecorder::GetDroppedFrames() const { return dropped_frames.load(); }
+
+void FrameRecorder::WriteRecords() {
+  std::unique_lock<std::mutex> lock(buffer_lock);
+
+  while (true) {
+    buffer_cond.wait(lock, [this] { return closing || buffered > 0; });
+    if (buffered == 0) return;
+
+    // The next record starts over at the front when too little is left for
+    // a header, down to nothing when the last one ended at the very end, or
+    // when a zero magic marks the rest as unused.
+    if (buffer.size() - read_pos < sizeof(CaptureRecord) ||
+        reinterpret_cast<const CaptureRecord*>(buffer.data() + read_pos)
+                ->magic == 0) {
+      buffered -= buffer.size() - read_pos;
+      read_pos = 0;
+      continue;
+    }
+    const uint8_t* data = buffer.data() + read_pos;
+    size_t size = GetCaptureRecordSize(
+        reinterpret_cast<const CaptureRecord*>(data)->payload_size);
+
+    // Producers never touch buffered bytes, so the copy needs no lock.
+    lock.unlock();
+    if (!failed && WriteRecord(data, size)) {
+      recorded_frames++;
+    } else {
+      dropped_frames++;
+    }
+    lock.lock();
+
+    read_pos += size;
+    buffered -= size;
+  }
+}
+
+bool FrameRecorder::WriteRecord(const uint8_t* record, size_t size) {
+  if (!segment || segment_used + size > segment_size) {
+    FinishSegment();
+    if (!StartSegment()) {
+      failed = true;
+      return false;
+    }
+  }
+
+  index.push_back(segment_offset + segment_used);
+  std::memcpy(segment + segment_used, record, size);
+  segment_used += size;
+  return true;
+}
+
+// Reserves the segment's blocks up front, so a full disk shows up as an
+// error here rather than as SIGBUS on a write to the mapping.
+bool FrameRecorder::StartSegment() {
+  uint64_t offset = segment_offset ? segment_offset + segment_size
+                                   : RoundUpToPage(sizeof(CaptureHeader));
+  int error = posix_fallocate(fd, offset, segment_size);
+  if (error) {
+    std::cerr << "!!!Error: cannot grow capture file `" << path
+              << "`, recording stopped: " << std::strerror(error)
+              << std::endl;
+    return false;
+  }
+
+  void* mapped = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, offset);
+  if (mapped == MAP_FAILED) {
+    std::cerr << "!!!Error: cannot map capture file `" << path
+              << "`, recording stopped: " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  madvise(mapped, segment_size, MADV_SEQUENTIAL);
+
+  segment = static_cast<uint8_t*>(mapped);
+  segment_offset = offset;
+  segment_used = 0;
+  return true;
+}
+
+// Starts writeback of the finished segment without waiting for it.
+void FrameRecorder::FinishSegment() {
+  if (!segment) return;
+
+  msync(segment, segment_size, MS_ASYNC);
+  munmap(segment, segment_size);
+  segment = nullptr;
+}
+
+void FrameRecorder::WriteIndex() {
+  uint64_t end = segment_offset ? segment_offset + segment_used
+                                : RoundUpToPage(sizeof(CaptureHeader));
+  FinishSegment();
+
+  size_t index_len = index.size() * sizeof(uint64_t);
+  CaptureHeader header = {kCaptureMagic,
+                          kCaptureVersion,
+                          RoundUpToPage(sizeof(CaptureHeader)),
+                          segment_size,
+                          end,
+                          index.size()};
+  if (ftruncate(fd, end) != 0 ||
+      pwrite(fd, index.data(), index_len, end) !=
+          static_cast<ssize_t>(index_len) ||
+      pwrite(fd, &header, sizeof(header), 0) !=
+          static_cast<ssize_t>(sizeof(header)) ||
+      fdatasync(fd) != 0) {
+    std::cerr << "!!!Error: cannot write capture file index `" << path
+              << "`: " << std::strerror(errno) << std::endl;
+  }
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,84 @@
+#ifndef LPTC_CODERDOJO_RECORDER_H_
+#define LPTC_CODERDOJO_RECORDER_H_
+
+#include "capture_file.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+const size_t kDefaultCaptureSegmentSize = 64 * 1024 * 1024;
+const size_t kDefaultRecordBufferSize = 32 * 1024 * 1024;
+
+// Appends frames to a capture file, laid out as described in
+// capture_file.h. Record copies the frame into a fixed in-memory buffer and
+// returns. A writer thread of its own moves buffered records into the
+// current segment, which is memory-mapped, and maps a fresh segment when it
+// fills, so the disk only sees large sequential writes. When the buffer is
+// full because the disk cannot keep up, frames are dropped and counted
+// rather than waited for, so recording never slows down publishing.
+class FrameRecorder {
+ public:
+  // Creates or truncates `path`. `segment_size` is rounded up to whole
+  // pages. Throws std::runtime_error when the file cannot be created.
+  FrameRecorder(const std::string& path,
+                size_t segment_size = kDefaultCaptureSegmentSize,
+                size_t buffer_size = kDefaultRecordBufferSize);
+  ~FrameRecorder();
+
+  // Queues a frame for writing. Fills in the magic and the payload size of
+  // `record`. Returns false when the frame was dropped.
+  bool Record(CaptureRecord record, const void* payload, size_t len);
+  // Writes out every buffered frame, then the index. Frames recorded
+  // afterwards are dropped. Called by the destructor.
+  void Close();
+
+  const std::string& GetPath() const;
+  size_t GetRecordedFrames() const;
+  size_t GetDroppedFrames() const;
+
+ private:
+  void WriteRecords();
+  // Copies one record into the current segment, mapping the next segment
+  // first when it does not fit. Returns false when the file cannot grow.
+  bool WriteRecord(const uint8_t* record, size_t size);
+  bool StartSegment();
+  void FinishSegment();
+  void WriteIndex();
+
+  const std::string path;
+  const size_t segment_size;
+  int fd;
+
+  // Written by the writer thread only.
+  uint8_t* segment;
+  uint64_t segment_offset;
+  size_t segment_used;
+  std::vector<uint64_t> index;
+  bool failed;
+
+  // Ring of whole records. A record that does not fit before the end
+  // starts over at the front, leaving a zero magic behind when there is room
+  // for one.
+  std::vector<uint8_t> buffer;
+  size_t read_pos;
+  size_t write_pos;
+  size_t buffered;
+  bool closing;
+  std::mutex buffer_lock;
+  std::condition_variable buffer_cond;
+
+  std::atomic<size_t> recorded_frames;
+  std::atomic<size_t> dropped_frames;
+  std::thread writer;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_RECORDER_H_
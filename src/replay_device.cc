@@ -0,0 +1,381 @@
+#include "replay_device.h"
+
+#include "../protocol/protocol_generated.h"
+#include "transform.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+typedef lptc_coderdojo::protocol::DataType DataType;
+
+// How long MAX_SPEED playback waits before asking a drained pool again.
+const std::chrono::milliseconds kFrameRetryInterval(1);
+
+bool IsDepthType(DataType type) {
+  return type == DataType::DepthRaw16 || type == DataType::DepthPacked11 ||
+         type == DataType::DepthRvl;
+}
+
+bool IsVideoType(DataType type) {
+  return type == DataType::Video || type == DataType::VideoRgb ||
+         type == DataType::VideoJpeg;
+}
+
+lptc_coderdojo::DepthFormat ToDepthFormat(uint8_t format) {
+  switch (format) {
+    case static_cast<uint8_t>(lptc_coderdojo::DepthFormat::REGISTERED):
+      return lptc_coderdojo::DepthFormat::REGISTERED;
+    case static_cast<uint8_t>(lptc_coderdojo::DepthFormat::MM):
+      return lptc_coderdojo::DepthFormat::MM;
+    default:
+      return lptc_coderdojo::DepthFormat::RAW11;
+  }
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+ReplayKinectDevice::ReplayKinectDevice(
+    std::shared_ptr<const CaptureReader> _capture, int _index,
+    const ReplayConfig& _replay, const DeviceConfig& config)
+    : capture(_capture),
+      index(_index),
+      replay(_replay),
+      recording(FindRecording(*_capture, _index)),
+      depth_pool(kDefaultFrameQueueDepth + kFramesInFlight,
+                 recording.depth_width * recording.depth_height),
+      video_pool(kDefaultFrameQueueDepth + kFramesInFlight,
+                 recording.video_width * recording.video_height * 3),
+      depth_frames(kDefaultFrameQueueDepth,
+                   replay.mode == ReplayMode::MAX_SPEED
+                       ? OverflowPolicy::BLOCK
+                       : OverflowPolicy::DROP_OLDEST),
+      video_frames(kDefaultFrameQueueDepth,
+                   replay.mode == ReplayMode::MAX_SPEED
+                       ? OverflowPolicy::BLOCK
+                       : OverflowPolicy::DROP_OLDEST),
+      synchronizer(config.sync_tolerance),
+      queue_depth(false),
+      queue_video(false),
+      sync_frames(false),
+      replayed_frames(0),
+      shut_down(false),
+      player(&ReplayKinectDevice::Run, this) {}
+
+ReplayKinectDevice::~ReplayKinectDevice() {
+  Shutdown();
+  player.join();
+}
+
+int ReplayKinectDevice::GetDepthFrameWidth() { return recording.depth_width; }
+
+int ReplayKinectDevice::GetDepthFrameHeight() {
+  return recording.depth_height;
+}
+
+int ReplayKinectDevice::GetDepthFrameRectSize() {
+  return recording.depth_width * recording.depth_height;
+}
+
+int ReplayKinectDevice::GetVideoFrameWidth() { return recording.video_width; }
+
+int ReplayKinectDevice::GetVideoFrameHeight() {
+  return recording.video_height;
+}
+
+int ReplayKinectDevice::GetVideoFrameRectSize() {
+  return recording.video_width * recording.video_height;
+}
+
+VideoFormat ReplayKinectDevice::GetVideoFormat() { return VideoFormat::RGB; }
+
+DepthFormat ReplayKinectDevice::GetDepthFormat() {
+  return recording.depth_format;
+}
+
+bool ReplayKinectDevice::GetNextDepthFrame(DepthFramePtr& frame) {
+  return depth_frames.Pop(frame);
+}
+
+bool ReplayKinectDevice::GetNextVideoFrame(VideoFramePtr& frame) {
+  return video_frames.Pop(frame);
+}
+
+bool ReplayKinectDevice::GetNextRgbdFrame(RgbdFrame& pair) {
+  return synchronizer.Pop(pair);
+}
+
+void ReplayKinectDevice::StartDepth() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    queue_depth = true;
+  }
+  run_cond.notify_all();
+}
+
+void ReplayKinectDevice::StartVideo() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    queue_video = true;
+  }
+  run_cond.notify_all();
+}
+
+void ReplayKinectDevice::StartRgbd() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    sync_frames = true;
+  }
+  run_cond.notify_all();
+}
+
+void ReplayKinectDevice::StopDepth() {
+  queue_depth = false;
+  depth_frames.Clear();
+}
+
+void ReplayKinectDevice::StopVideo() {
+  queue_video = false;
+  video_frames.Clear();
+}
+
+void ReplayKinectDevice::StopRgbd() {
+  sync_frames = false;
+  synchronizer.Clear();
+}
+
+void ReplayKinectDevice::Shutdown() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    shut_down = true;
+  }
+  run_cond.notify_all();
+  depth_frames.Close();
+  video_frames.Close();
+  synchronizer.Close();
+}
+
+// In MAX_SPEED mode playback waits for free frames instead of losing them,
+// so only the queues can drop.
+StreamStats ReplayKinectDevice::GetDepthStats() {
+  size_t missed =
+      replay.mode == ReplayMode::MAX_SPEED ? 0 : depth_pool.GetMisses();
+  return {depth_frames.GetSize(), depth_frames.GetDroppedFrames() + missed};
+}
+
+StreamStats ReplayKinectDevice::GetVideoStats() {
+  size_t missed =
+      replay.mode == ReplayMode::MAX_SPEED ? 0 : video_pool.GetMisses();
+  return {video_frames.GetSize(), video_frames.GetDroppedFrames() + missed};
+}
+
+StreamStats ReplayKinectDevice::GetRgbdStats() {
+  return {synchronizer.GetPendingPairs(), synchronizer.GetDroppedPairs()};
+}
+
+size_t ReplayKinectDevice::GetReplayedFrames() const {
+  return replayed_frames.load();
+}
+
+ReplayKinectDevice::Recording ReplayKinectDevice::FindRecording(
+    const CaptureReader& capture, int index) {
+  Recording recording = {};
+
+  for (const CaptureRecord* record : capture.GetRecords()) {
+    DataType type = static_cast<DataType>(record->data_type);
+    if (record->device != index) continue;
+
+    if (IsDepthType(type)) {
+      if (!recording.depth_width) {
+        recording.depth_width = record->width;
+        recording.depth_height = record->height;
+        recording.depth_format = ToDepthFormat(record->format);
+      } else if (record->width != recording.depth_width ||
+                 record->height != recording.depth_height) {
+        continue;
+      }
+    } else if (IsVideoType(type)) {
+      if (!recording.video_width) {
+        recording.video_width = record->width;
+        recording.video_height = record->height;
+      } else if (record->width != recording.video_width ||
+                 record->height != recording.video_height) {
+        continue;
+      }
+    } else {
+      continue;
+    }
+    recording.records.push_back(record);
+  }
+
+  const char* missing = !recording.depth_width   ? "depth"
+                        : !recording.video_width ? "video"
+                                                 : nullptr;
+  if (missing) {
+    throw std::runtime_error("`" + capture.GetPath() + "` has no replayable " +
+                             missing + " frames of device " +
+                             std::to_string(index));
+  }
+  return recording;
+}
+
+void ReplayKinectDevice::Run() {
+  const std::vector<const CaptureRecord*>& records = recording.records;
+  int64_t first_capture_us = records.front()->capture_time_us;
+
+  for (int pass = 0; replay.loops == 0 || pass < replay.loops; pass++) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    // Capture times keep the recorded spacing, counted from the pass start.
+    std::chrono::system_clock::time_point capture_start =
+        std::chrono::system_clock::now();
+    size_t replayed = 0;
+
+    for (const CaptureRecord* record : records) {
+      bool paused;
+      if (!WaitForConsumers(&paused)) return;
+
+      std::chrono::microseconds offset(record->capture_time_us -
+                                       first_capture_us);
+      if (replay.mode == ReplayMode::REALTIME) {
+        // Resume where playback paused rather than catching up.
+        if (paused || record == records.front()) {
+          start = std::chrono::steady_clock::now() - offset;
+          capture_start = std::chrono::system_clock::now() - offset;
+        }
+        std::unique_lock<std::mutex> lock(run_lock);
+        if (run_cond.wait_until(lock, start + offset,
+                                [this] { return shut_down; }))
+          return;
+      }
+
+      DataType type = static_cast<DataType>(record->data_type);
+      std::chrono::system_clock::time_point capture_time =
+          capture_start + offset;
+      if (IsDepthType(type) ? ReplayDepth(record, capture_time)
+                            : ReplayVideo(record, capture_time))
+        replayed++;
+    }
+
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << "Replayed " << replayed << " frame(s) of device " << index
+              << " in " << seconds << " s ("
+              << (seconds > 0 ? replayed / seconds : 0) << " frames/s)."
+              << std::endl;
+  }
+}
+
+bool ReplayKinectDevice::WaitForConsumers(bool* paused) {
+  std::unique_lock<std::mutex> lock(run_lock);
+
+  *paused = false;
+  while (!shut_down && !queue_depth && !queue_video && !sync_frames) {
+    *paused = true;
+    run_cond.wait(lock);
+  }
+  return !shut_down;
+}
+
+template <typename T>
+std::shared_ptr<Frame<T>> ReplayKinectDevice::AcquireFrame(
+    FramePool<T>& pool) {
+  std::shared_ptr<Frame<T>> frame = pool.Acquire();
+  if (frame || replay.mode != ReplayMode::MAX_SPEED) return frame;
+
+  std::unique_lock<std::mutex> lock(run_lock);
+  while (!frame && !shut_down) {
+    run_cond.wait_for(lock, kFrameRetryInterval);
+    frame = pool.Acquire();
+  }
+  return frame;
+}
+
+bool ReplayKinectDevice::ReplayDepth(
+    const CaptureRecord* record,
+    std::chrono::system_clock::time_point capture_time) {
+  bool queued = queue_depth.load();
+  bool synced = sync_frames.load();
+  if (!queued && !synced) return false;
+  DepthFramePtr frame = AcquireFrame(depth_pool);
+  if (!frame) return false;
+
+  const uint8_t* payload = CaptureReader::GetPayload(record);
+  size_t pixels = frame->data.size();
+  bool decoded;
+  switch (static_cast<DataType>(record->data_type)) {
+    case DataType::DepthRaw16:
+      decoded = record->payload_size == pixels * sizeof(uint16_t);
+      if (decoded) std::memcpy(frame->data.data(), payload, pixels * 2);
+      break;
+    case DataType::DepthPacked11:
+      decoded = record->payload_size == GetPacked11Size(pixels);
+      if (decoded) {
+        TransformPacked11ToDepth(payload, frame->data.data(), pixels);
+      }
+      break;
+    default:
+      decoded = DecodeRvl(payload, record->payload_size, frame->data.data(),
+                          pixels);
+      break;
+  }
+  if (!decoded) return false;
+
+  frame->timestamp = record->device_timestamp;
+  frame->capture_time = capture_time;
+  replayed_frames++;
+  frame->queued_time = std::chrono::system_clock::now();
+  if (synced) synchronizer.AddDepth(frame);
+  if (queued) depth_frames.Push(std::move(frame));
+  return true;
+}
+
+bool ReplayKinectDevice::ReplayVideo(
+    const CaptureRecord* record,
+    std::chrono::system_clock::time_point capture_time) {
+  bool queued = queue_video.load();
+  bool synced = sync_frames.load();
+  if (!queued && !synced) return false;
+  VideoFramePtr frame = AcquireFrame(video_pool);
+  if (!frame) return false;
+
+  const uint8_t* payload = CaptureReader::GetPayload(record);
+  uint8_t* rgb = frame->data.data();
+  size_t pixels = frame->data.size() / 3;
+  bool decoded;
+  switch (static_cast<DataType>(record->data_type)) {
+    case DataType::VideoRgb:
+      decoded = record->payload_size == pixels * 3;
+      if (decoded) std::memcpy(rgb, payload, pixels * 3);
+      break;
+    case DataType::Video:
+      decoded = record->payload_size == pixels * 4;
+      for (size_t i = 0; decoded && i < pixels; i++) {
+        rgb[i * 3] = payload[i * 4];
+        rgb[i * 3 + 1] = payload[i * 4 + 1];
+        rgb[i * 3 + 2] = payload[i * 4 + 2];
+      }
+      break;
+    default:
+      decoded = jpeg_decoder.Decode(payload, record->payload_size,
+                                    recording.video_width,
+                                    recording.video_height, rgb);
+      break;
+  }
+  if (!decoded) return false;
+
+  frame->timestamp = record->device_timestamp;
+  frame->capture_time = capture_time;
+  replayed_frames++;
+  frame->queued_time = std::chrono::system_clock::now();
+  if (synced) synchronizer.AddVideo(frame);
+  if (queued) video_frames.Push(std::move(frame));
+  return true;
+}
+
+}  // namespace lptc_coderdojo
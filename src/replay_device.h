@@ -0,0 +1,123 @@
+#ifndef LPTC_CODERDOJO_REPLAY_DEVICE_H_
+#define LPTC_CODERDOJO_REPLAY_DEVICE_H_
+
+#include "capture_file.h"
+#include "codec.h"
+#include "config.h"
+#include "device.h"
+#include "frame.h"
+#include "frame_queue.h"
+#include "frame_synchronizer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Plays back one recorded device of a capture file. Payloads are decoded
+// straight from the file's mapped pages into pooled frames. Depth recorded
+// as raw16, packed11 or rvl and video recorded as rgb, rgba or jpeg can be
+// replayed; video is always handed on as RGB. Frames keep their recorded
+// device timestamp and get capture times spaced as recorded from the start
+// of the pass, so pairing and skew match the original capture in both modes.
+//
+// In MAX_SPEED mode the frame queues block instead of dropping, so playback
+// runs exactly as fast as the depth and video publishers consume frames.
+// The rgbd channel does not hold playback back and only gets the pairs it
+// keeps up with. Playback pauses while no consumer is started.
+class ReplayKinectDevice : public KinectDevice {
+ public:
+  typedef FramePool<uint16_t> DepthFramePool;
+  typedef FramePool<uint8_t> VideoFramePool;
+  typedef FrameQueue<uint16_t> DepthFrameQueue;
+  typedef FrameQueue<uint8_t> VideoFrameQueue;
+
+  // Throws std::runtime_error when `capture` has no replayable depth or no
+  // replayable video frames of device `index`.
+  ReplayKinectDevice(std::shared_ptr<const CaptureReader> capture, int index,
+                     const lptc_coderdojo::ReplayConfig& replay,
+                     const lptc_coderdojo::DeviceConfig& config);
+  ~ReplayKinectDevice();
+
+  int GetDepthFrameWidth();
+  int GetDepthFrameHeight();
+  int GetDepthFrameRectSize();
+  int GetVideoFrameWidth();
+  int GetVideoFrameHeight();
+  int GetVideoFrameRectSize();
+  lptc_coderdojo::VideoFormat GetVideoFormat();
+  lptc_coderdojo::DepthFormat GetDepthFormat();
+  bool GetNextDepthFrame(DepthFramePtr&);
+  bool GetNextVideoFrame(VideoFramePtr&);
+  bool GetNextRgbdFrame(RgbdFrame&);
+  void StartDepth();
+  void StartVideo();
+  void StartRgbd();
+  void StopDepth();
+  void StopVideo();
+  void StopRgbd();
+  void Shutdown();
+  lptc_coderdojo::StreamStats GetDepthStats();
+  lptc_coderdojo::StreamStats GetVideoStats();
+  lptc_coderdojo::StreamStats GetRgbdStats();
+
+  // Frames handed to a consumer since the device was opened.
+  size_t GetReplayedFrames() const;
+
+ private:
+  // The device's replayable records, in file order, and the frame sizes
+  // they share.
+  struct Recording {
+    std::vector<const CaptureRecord*> records;
+    int depth_width;
+    int depth_height;
+    lptc_coderdojo::DepthFormat depth_format;
+    int video_width;
+    int video_height;
+  };
+
+  static Recording FindRecording(const CaptureReader& capture, int index);
+
+  void Run();
+  // Blocks while no consumer is started. Sets `paused` when it had to wait.
+  // Returns false once the device is shut down.
+  bool WaitForConsumers(bool* paused);
+  // Waits for a free frame in MAX_SPEED mode; gives up at once otherwise.
+  template <typename T>
+  std::shared_ptr<Frame<T>> AcquireFrame(FramePool<T>& pool);
+  bool ReplayDepth(const CaptureRecord* record,
+                   std::chrono::system_clock::time_point capture_time);
+  bool ReplayVideo(const CaptureRecord* record,
+                   std::chrono::system_clock::time_point capture_time);
+
+  const std::shared_ptr<const CaptureReader> capture;
+  const int index;
+  const lptc_coderdojo::ReplayConfig replay;
+  const Recording recording;
+
+  DepthFramePool depth_pool;
+  VideoFramePool video_pool;
+  DepthFrameQueue depth_frames;
+  VideoFrameQueue video_frames;
+  FrameSynchronizer synchronizer;
+  // Used by the replay thread only.
+  JpegDecoder jpeg_decoder;
+
+  std::atomic<bool> queue_depth;
+  std::atomic<bool> queue_video;
+  std::atomic<bool> sync_frames;
+  std::atomic<size_t> replayed_frames;
+  bool shut_down;
+  std::mutex run_lock;
+  std::condition_variable run_cond;
+  std::thread player;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_REPLAY_DEVICE_H_
@@ -0,0 +1,65 @@
+#include "config.h"
+#include "load_generator.h"
+
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+// Prints one row: frames per second, megabytes per second, capture to
+// receive latency percentiles in milliseconds and errors.
+void PrintReportRow(const std::string& name,
+                    lptc_coderdojo::ClientReport& report, double seconds) {
+  std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(9) << report.frames / seconds
+            << std::setw(9) << report.bytes / seconds / 1e6 << std::setw(9)
+            << report.latency.GetPercentile(50) / 1e3 << std::setw(9)
+            << report.latency.GetPercentile(99) / 1e3 << std::setw(9)
+            << report.latency.GetPercentile(99.9) / 1e3 << std::setw(8)
+            << report.errors << (report.connected ? "" : "  disconnected")
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  lptc_coderdojo::LoadConfig config;
+  std::string error;
+  if (!lptc_coderdojo::ParseLoadCommandLine(argc, argv, &config, &error)) {
+    std::cerr << "!!!Error: " << error << std::endl
+              << lptc_coderdojo::GetLoadUsage(argv[0]);
+    return 1;
+  }
+  if (config.show_help) {
+    std::cout << lptc_coderdojo::GetLoadUsage(argv[0]);
+    return 0;
+  }
+
+  std::cout << "Connecting " << config.clients << " client(s) to "
+            << config.host << ":" << config.port << ", measuring for "
+            << config.duration.count() << " s after a "
+            << config.warmup.count() << " s warm-up." << std::endl;
+  lptc_coderdojo::LoadGenerator generator(config);
+  std::vector<lptc_coderdojo::ClientReport> reports = generator.Run();
+  if (reports.empty()) return 1;
+
+  double seconds = std::chrono::duration<double>(generator.GetMeasuredTime())
+                       .count();
+  std::cout << "client        fps     MB/s   p50 ms   p99 ms p99.9 ms  errors"
+            << std::endl;
+  lptc_coderdojo::ClientReport total;
+  total.connected = true;
+  size_t connected = 0;
+  for (size_t i = 0; i < reports.size(); i++) {
+    PrintReportRow(std::to_string(i), reports[i], seconds);
+    total.frames += reports[i].frames;
+    total.bytes += reports[i].bytes;
+    total.errors += reports[i].errors;
+    total.latency.Merge(reports[i].latency);
+    if (reports[i].connected) connected++;
+  }
+  PrintReportRow("total", total, seconds);
+  std::cout << connected << " of " << reports.size()
+            << " client(s) stayed connected." << std::endl;
+  return connected == reports.size() ? 0 : 1;
+}
@@ -1,8 +1,36 @@
+#include "config.h"
+#include "replay_device.h"
 #include "server.h"
+#include "synthetic_device.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 
 namespace {
 volatile std::sig_atomic_t sig_status;
 lptc_coderdojo::BroadcastServer* kserver;
+
+// Recording goes through the same publishers as subscribers, so it can only
+// use an encoding the channel offers.
+bool MakeRecordVariant(lptc_coderdojo::Encoding encoding,
+                       const lptc_coderdojo::EncodingList& supported,
+                       const std::string& stream,
+                       lptc_coderdojo::StreamVariant* variant) {
+  std::string error;
+  if (std::find(supported.begin(), supported.end(), encoding) ==
+      supported.end()) {
+    error = std::string("cannot record ") + stream + " as " +
+            lptc_coderdojo::EncodingName(encoding);
+  } else {
+    lptc_coderdojo::Command::Params params;
+    params["format"] = lptc_coderdojo::EncodingName(encoding);
+    if (lptc_coderdojo::StreamVariant::FromParams(params, variant, &error))
+      return true;
+  }
+  std::cerr << "!!!Error: " << error << "." << std::endl;
+  return false;
+}
 }  // namespace
 
 void SignalHandler(int signal) {
@@ -11,14 +39,123 @@ void SignalHandler(int signal) {
   if (sig_status == SIGINT || sig_status == SIGTERM) kserver->Stop();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+  lptc_coderdojo::ServerConfig config;
+  std::string error;
+  if (!lptc_coderdojo::ParseCommandLine(argc, argv, &config, &error)) {
+    std::cerr << "!!!Error: " << error << std::endl
+              << lptc_coderdojo::GetUsage(argv[0]);
+    return 1;
+  }
+  if (config.show_help) {
+    std::cout << lptc_coderdojo::GetUsage(argv[0]);
+    return 0;
+  }
+
   std::signal(SIGINT, SignalHandler);
   std::signal(SIGTERM, SignalHandler);
 
-  Freenect::Freenect freenect;
-  lptc_coderdojo::KinectDevice& device =
-      freenect.createDevice<lptc_coderdojo::OpenKinectDevice>(0);
+  lptc_coderdojo::DeviceSource source = config.source;
+  // libfreenect is only initialized when Kinects are used, so synthetic and
+  // replayed devices run on machines without USB access.
+  std::unique_ptr<Freenect::Freenect> freenect;
+  std::shared_ptr<const lptc_coderdojo::CaptureReader> capture;
+  std::vector<std::unique_ptr<lptc_coderdojo::KinectDevice>> owned_devices;
+  std::vector<int> indices = config.device_indices;
+  if (source == lptc_coderdojo::DeviceSource::SYNTHETIC) {
+    if (indices.empty()) indices.push_back(0);
+  } else if (source == lptc_coderdojo::DeviceSource::REPLAY) {
+    if (config.replay.path.empty()) {
+      std::cerr << "!!!Error: the replay source needs --replay." << std::endl
+                << lptc_coderdojo::GetUsage(argv[0]);
+      return 1;
+    }
+    try {
+      capture =
+          std::make_shared<lptc_coderdojo::CaptureReader>(config.replay.path);
+    } catch (const std::runtime_error& e) {
+      std::cerr << "!!!Error: " << e.what() << std::endl;
+      return 1;
+    }
+    if (indices.empty()) indices = capture->GetDevices();
+  } else {
+    freenect.reset(new Freenect::Freenect);
+    if (indices.empty()) {
+      for (int i = 0; i < freenect->deviceCount(); i++) indices.push_back(i);
+    }
+  }
+  if (indices.empty()) {
+    std::cerr << "!!!Error: no Kinect attached." << std::endl;
+    return 1;
+  }
+
+  lptc_coderdojo::DeviceMap devices;
+  for (int index : indices) {
+    const char* label = "Kinect #";
+    try {
+      if (source == lptc_coderdojo::DeviceSource::SYNTHETIC) {
+        label = "Synthetic Kinect #";
+        owned_devices.emplace_back(
+            new lptc_coderdojo::SyntheticKinectDevice(index, config.device));
+        devices[index] = owned_devices.back().get();
+      } else if (source == lptc_coderdojo::DeviceSource::REPLAY) {
+        label = "Replayed Kinect #";
+        owned_devices.emplace_back(new lptc_coderdojo::ReplayKinectDevice(
+            capture, index, config.replay, config.device));
+        devices[index] = owned_devices.back().get();
+      } else {
+        devices[index] =
+            &freenect->createDevice<lptc_coderdojo::OpenKinectDevice>(
+                index, config.device);
+      }
+    } catch (const std::runtime_error& e) {
+      std::cerr << "!!!Error: " << label << index << ": " << e.what()
+                << std::endl;
+      return 1;
+    }
+
+    lptc_coderdojo::KinectDevice& device = *devices[index];
+    std::cout << label << index << ": " << device.GetVideoFrameWidth() << "x"
+              << device.GetVideoFrameHeight() << " "
+              << lptc_coderdojo::VideoFormatName(device.GetVideoFormat())
+              << " video, " << device.GetDepthFrameWidth() << "x"
+              << device.GetDepthFrameHeight() << " "
+              << lptc_coderdojo::DepthFormatName(device.GetDepthFormat())
+              << " depth." << std::endl;
+  }
+
+  kserver = new lptc_coderdojo::BroadcastServer(
+      devices, config.port, config.io_threads, config.transform_threads);
+
+  std::unique_ptr<lptc_coderdojo::FrameRecorder> recorder;
+  if (!config.record_path.empty()) {
+    lptc_coderdojo::StreamVariant depth_variant;
+    lptc_coderdojo::StreamVariant video_variant;
+    lptc_coderdojo::EncodingList depth_encodings =
+        lptc_coderdojo::DepthDataPublisher::GetSupportedEncodings(
+            devices.begin()->second->GetDepthFormat());
+    lptc_coderdojo::EncodingList video_encodings =
+        lptc_coderdojo::VideoDataPublisher::GetSupportedEncodings();
+    if (!MakeRecordVariant(config.record_depth_encoding, depth_encodings,
+                           "depth", &depth_variant) ||
+        !MakeRecordVariant(config.record_video_encoding, video_encodings,
+                           "video", &video_variant)) {
+      return 1;
+    }
+    try {
+      recorder.reset(new lptc_coderdojo::FrameRecorder(config.record_path));
+    } catch (const std::runtime_error& e) {
+      std::cerr << "!!!Error: " << e.what() << std::endl;
+      return 1;
+    }
+    kserver->Record(recorder.get(), depth_variant, video_variant);
+  }
 
-  kserver = new lptc_coderdojo::BroadcastServer(device, 9002);
   kserver->Run();
-}
\ No newline at end of file
+  if (recorder) {
+    recorder->Close();
+    std::cout << "Recorded " << recorder->GetRecordedFrames()
+              << " frame(s) to `" << recorder->GetPath() << "`, dropped "
+              << recorder->GetDroppedFrames() << "." << std::endl;
+  }
+}
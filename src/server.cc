@@ -4,18 +4,101 @@
 #include "command.h"
 
 #include <flatbuffers/flatbuffers.h>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+size_t GetDefaultIoThreads() {
+  size_t cores = std::thread::hardware_concurrency();
+  return std::max<size_t>(
+      1, std::min(cores, lptc_coderdojo::kMaxDefaultIoThreads));
+}
+
+size_t GetDefaultTransformThreads(size_t io_threads) {
+  size_t cores = std::thread::hardware_concurrency();
+  size_t spare = cores > io_threads ? cores - io_threads : 1;
+  return std::min(spare, lptc_coderdojo::kMaxDefaultTransformThreads);
+}
+
+// Unwraps a device's serialized frames back into their payloads for the
+// recorder. Messages carry the capture time in milliseconds, so that is the
+// precision recorded.
+class RecordingSink : public lptc_coderdojo::ChannelSink {
+ public:
+  RecordingSink(lptc_coderdojo::FrameRecorder& _recorder, int _device,
+                lptc_coderdojo::DepthFormat _depth_format)
+      : recorder(_recorder), device(_device), depth_format(_depth_format) {}
+
+  void Consume(const lptc_coderdojo::StreamVariant& variant, void const* data,
+               size_t len) {
+    const lptc_coderdojo::protocol::Message* message =
+        lptc_coderdojo::protocol::GetMessage(data);
+    const lptc_coderdojo::protocol::DeviceData* frame = message->data();
+    if (!frame) return;
+
+    const void* payload;
+    size_t payload_len;
+    if (frame->depth_raw()) {
+      payload = frame->depth_raw()->data();
+      payload_len = frame->depth_raw()->size() * sizeof(uint16_t);
+    } else if (frame->depth()) {
+      payload = frame->depth()->data();
+      payload_len = frame->depth()->size();
+    } else if (frame->video()) {
+      payload = frame->video()->data();
+      payload_len = frame->video()->size();
+    } else {
+      return;
+    }
+
+    lptc_coderdojo::CaptureRecord record = {};
+    record.data_type = static_cast<uint8_t>(frame->type());
+    record.device = static_cast<uint8_t>(device);
+    record.format = static_cast<uint8_t>(depth_format);
+    record.width = static_cast<uint16_t>(frame->width());
+    record.height = static_cast<uint16_t>(frame->height());
+    record.device_timestamp = frame->device_timestamp();
+    record.capture_time_us = message->timestamp() * 1000;
+    recorder.Record(record, payload, payload_len);
+  }
+
+ private:
+  lptc_coderdojo::FrameRecorder& recorder;
+  const int device;
+  const lptc_coderdojo::DepthFormat depth_format;
+};
+
+}  // namespace
 
 namespace lptc_coderdojo {
 
-BroadcastServer::BroadcastServer(lptc_coderdojo::KinectDevice& _device,
-                                 const int _port)
-    : port(_port), device(_device) {
+std::string GetDeviceTopic(int index, const std::string& stream) {
+  std::ostringstream oss;
+  oss << "kinect" << index << "/" << stream;
+  return oss.str();
+}
+
+BroadcastServer::BroadcastServer(const lptc_coderdojo::DeviceMap& _devices,
+                                 const int _port, const size_t _io_threads,
+                                 const size_t _transform_threads)
+    : port(_port),
+      io_threads(_io_threads ? _io_threads : GetDefaultIoThreads()),
+      transform_threads(_transform_threads
+                            ? _transform_threads
+                            : GetDefaultTransformThreads(io_threads)),
+      devices(_devices),
+      recorder(nullptr) {
   s.clear_access_channels(websocketpp::log::alevel::all);
   s.init_asio();
   s.set_open_handler(std::bind(&BroadcastServer::OnConnectionOpened, this,
                                std::placeholders::_1));
   s.set_close_handler(std::bind(&BroadcastServer::OnConnectionClosed, this,
                                 std::placeholders::_1));
+  s.set_http_handler(std::bind(&BroadcastServer::OnHttpRequest, this,
+                               std::placeholders::_1));
   s.set_message_handler(std::bind(&BroadcastServer::OnMessage, this,
                                   std::placeholders::_1,
                                   std::placeholders::_2));
@@ -30,9 +113,23 @@ void BroadcastServer::BroadcastToChannel(const std::string ch_name,
     return;
   }
 
-  while (term_future.wait_for(std::chrono::microseconds(1)) ==
-         std::future_status::timeout) {
-    publisher.PublishNewData(ch);
+  // Keep the device stream running only while someone is subscribed.
+  while (ch->WaitForSubscribers()) {
+    std::chrono::steady_clock::time_point started =
+        std::chrono::steady_clock::now();
+    publisher.StartStream();
+
+    bool warming_up = true;
+    while (ch->HasSubscribers() && publisher.PublishNewData(ch)) {
+      if (!warming_up) continue;
+      warming_up = false;
+      std::cout << "`" << ch_name << "` stream warmed up in "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - started)
+                       .count()
+                << " ms." << std::endl;
+    }
+    publisher.StopStream();
   }
   std::cout << "Stopped broadcasting to `" << ch_name << "` channel."
             << std::endl;
@@ -52,8 +149,32 @@ void BroadcastServer::CloseConnections(const std::string& reason) {
   }
 }
 
+std::string BroadcastServer::FormatMetrics() {
+  std::vector<lptc_coderdojo::ChannelReport> reports;
+  DeviceMap::iterator iter;
+  for (iter = devices.begin(); iter != devices.end(); ++iter) {
+    lptc_coderdojo::KinectDevice& device = *iter->second;
+    const std::string streams[] = {"video", "depth", "rgbd"};
+    const lptc_coderdojo::StreamStats stats[] = {
+        device.GetVideoStats(), device.GetDepthStats(), device.GetRgbdStats()};
+
+    for (size_t i = 0; i < 3; i++) {
+      lptc_coderdojo::Channel* ch =
+          GetChannel(GetDeviceTopic(iter->first, streams[i]));
+      if (!ch) continue;
+      lptc_coderdojo::ChannelReport report = {
+          ch->GetTopic(), ch->GetSubscriberCount(), stats[i].queued_frames,
+          stats[i].dropped_frames, &ch->GetMetrics()};
+      reports.push_back(report);
+    }
+  }
+  return lptc_coderdojo::FormatPrometheusMetrics(reports);
+}
+
 lptc_coderdojo::Channel* BroadcastServer::GetChannel(const std::string& topic) {
-  ChannelMap::iterator search = channels.find(topic);
+  AliasMap::const_iterator alias = aliases.find(topic);
+  ChannelMap::iterator search =
+      channels.find(alias != aliases.end() ? alias->second : topic);
   if (search != channels.end()) return &search->second;
 
   return NULL;
@@ -74,6 +195,20 @@ void BroadcastServer::OnConnectionOpened(websocketpp::connection_hdl hdl) {
   connections.insert(hdl);
 }
 
+// Plain HTTP requests to the websocket port, such as a metrics scrape.
+void BroadcastServer::OnHttpRequest(websocketpp::connection_hdl hdl) {
+  AsioServer::connection_ptr conn = s.get_con_from_hdl(hdl);
+  if (conn->get_resource() != kMetricsResource) {
+    conn->set_status(websocketpp::http::status_code::not_found);
+    conn->set_body("Not found.\n");
+    return;
+  }
+
+  conn->set_status(websocketpp::http::status_code::ok);
+  conn->replace_header("Content-Type", lptc_coderdojo::kPrometheusContentType);
+  conn->set_body(FormatMetrics());
+}
+
 void BroadcastServer::OnMessage(websocketpp::connection_hdl hdl,
                                 AsioServer::message_ptr msg) {
   Command cmd = Command::FromMessagePayload(msg->get_payload());
@@ -90,19 +225,46 @@ void BroadcastServer::OnMessage(websocketpp::connection_hdl hdl,
     return;
   }
 
-  if (action == Command::Action::SUBSCRIBE) {
+  if (action == Command::Action::SUBSCRIBE && cmd.GetTopic() == kStatsTopic) {
+    if (!cmd.GetParams().empty()) {
+      SendErrorMessage(hdl, "The stats channel takes no parameters.");
+      return;
+    }
     ch->Subscribe(hdl);
+  } else if (action == Command::Action::SUBSCRIBE) {
+    lptc_coderdojo::StreamVariant variant;
+    std::string error;
+    if (!lptc_coderdojo::StreamVariant::FromParams(cmd.GetParams(), &variant,
+                                                   &error)) {
+      SendErrorMessage(hdl, error);
+      return;
+    }
+    if (!ch->SupportsEncoding(variant.encoding)) {
+      SendErrorMessage(hdl, "Unsupported format for channel.");
+      return;
+    }
+    ch->Subscribe(hdl, variant);
   } else if (action == Command::Action::UNSUBSCRIBE) {
     ch->Unsubscribe(hdl);
   }
 }
 
-void BroadcastServer::RegisterChannel(const std::string& name) {
-  lptc_coderdojo::Channel ch(name, s);
-  channels.insert(ChannelMap::value_type(ch.GetTopic(), ch));
+// Sends the metrics to the stats channel while it has subscribers.
+void BroadcastServer::PublishStats() {
+  lptc_coderdojo::Channel* ch = GetChannel(kStatsTopic);
+  while (ch->WaitForSubscribers()) {
+    std::string text = FormatMetrics();
+    ch->Publish(lptc_coderdojo::StreamVariant(), text.data(), text.size(),
+                websocketpp::frame::opcode::text);
+    if (ch->WaitForClose(kStatsInterval)) return;
+  }
 }
 
-void BroadcastServer::StopAllChannelBroadcasts() { term_sig.set_value(); }
+void BroadcastServer::RegisterChannel(
+    const std::string& name, const lptc_coderdojo::EncodingList& encodings) {
+  lptc_coderdojo::Channel ch(name, s, encodings);
+  channels.insert(ChannelMap::value_type(ch.GetTopic(), ch));
+}
 
 void BroadcastServer::SendErrorMessage(websocketpp::connection_hdl hdl,
                                        const std::string& error_msg) {
@@ -125,42 +287,120 @@ void BroadcastServer::SendErrorMessage(websocketpp::connection_hdl hdl,
          websocketpp::frame::opcode::binary);
 }
 
+void BroadcastServer::Record(
+    lptc_coderdojo::FrameRecorder* _recorder,
+    const lptc_coderdojo::StreamVariant& depth_variant,
+    const lptc_coderdojo::StreamVariant& video_variant) {
+  recorder = _recorder;
+  record_depth = depth_variant;
+  record_video = video_variant;
+}
+
 void BroadcastServer::Run() {
   s.listen(port);
   s.start_accept();
   std::cout << "Listening on port " << port << "..." << std::endl;
   std::cout << "Started Kinect BroadcastServer." << std::endl;
 
-  term_future = term_sig.get_future();
+  // Publisher threads lend themselves to their own frames, so the pool only
+  // needs the remaining threads.
+  lptc_coderdojo::WorkerPool transform_pool(transform_threads - 1);
+  std::cout << "Transforming frames on up to " << transform_threads
+            << " thread(s)." << std::endl;
+
+  // Every channel exists before the first broadcast thread looks one up.
+  std::vector<std::string> topics;
+  std::vector<std::unique_ptr<lptc_coderdojo::Publisher>> publishers;
+  DeviceMap::iterator iter;
+  for (iter = devices.begin(); iter != devices.end(); ++iter) {
+    lptc_coderdojo::KinectDevice& device = *iter->second;
+
+    topics.push_back(GetDeviceTopic(iter->first, "video"));
+    RegisterChannel(
+        topics.back(),
+        lptc_coderdojo::VideoDataPublisher::GetSupportedEncodings());
+    publishers.emplace_back(
+        new lptc_coderdojo::VideoDataPublisher(device, transform_pool));
 
-  device.StartVideo();
-  RegisterChannel("video");
-  lptc_coderdojo::VideoDataPublisher video_pub(device);
-  std::thread video_broadcast_thread(std::bind(
-      &BroadcastServer::BroadcastToChannel, this, "video", video_pub));
+    topics.push_back(GetDeviceTopic(iter->first, "depth"));
+    RegisterChannel(topics.back(),
+                    lptc_coderdojo::DepthDataPublisher::GetSupportedEncodings(
+                        device.GetDepthFormat()));
+    publishers.emplace_back(
+        new lptc_coderdojo::DepthDataPublisher(device, transform_pool));
 
-  device.StartDepth();
-  RegisterChannel("depth");
-  lptc_coderdojo::DepthDataPublisher depth_pub(device);
-  std::thread depth_broadcast_thread(std::bind(
-      &BroadcastServer::BroadcastToChannel, this, "depth", depth_pub));
+    topics.push_back(GetDeviceTopic(iter->first, "rgbd"));
+    RegisterChannel(topics.back(),
+                    lptc_coderdojo::RgbdDataPublisher::GetSupportedEncodings(
+                        device.GetDepthFormat()));
+    publishers.emplace_back(
+        new lptc_coderdojo::RgbdDataPublisher(device, transform_pool));
+  }
+  // Stats subscribers always get the default variant, so the channel needs
+  // no encodings.
+  RegisterChannel(kStatsTopic, lptc_coderdojo::EncodingList());
+  if (!devices.empty()) {
+    aliases["video"] = GetDeviceTopic(devices.begin()->first, "video");
+    aliases["depth"] = GetDeviceTopic(devices.begin()->first, "depth");
+    aliases["rgbd"] = GetDeviceTopic(devices.begin()->first, "rgbd");
+  }
+  if (recorder) {
+    std::cout << "Recording to `" << recorder->GetPath() << "` as "
+              << lptc_coderdojo::EncodingName(record_depth.encoding)
+              << " depth and "
+              << lptc_coderdojo::EncodingName(record_video.encoding)
+              << " video." << std::endl;
+    for (iter = devices.begin(); iter != devices.end(); ++iter) {
+      std::shared_ptr<lptc_coderdojo::ChannelSink> sink =
+          std::make_shared<RecordingSink>(*recorder, iter->first,
+                                          iter->second->GetDepthFormat());
+      GetChannel(GetDeviceTopic(iter->first, "depth"))
+          ->AttachSink(sink, record_depth);
+      GetChannel(GetDeviceTopic(iter->first, "video"))
+          ->AttachSink(sink, record_video);
+    }
+  }
 
+  std::vector<std::thread> broadcast_threads;
+  for (size_t i = 0; i < publishers.size(); i++) {
+    broadcast_threads.push_back(
+        std::thread(std::bind(&BroadcastServer::BroadcastToChannel, this,
+                              topics[i], std::ref(*publishers[i]))));
+  }
+  std::thread stats_thread(&BroadcastServer::PublishStats, this);
+
+  // websocketpp's asio config gives every connection its own strand, so its
+  // handlers stay serialized however many threads run the loop, and
+  // connection::send dispatches writes from broadcast threads through it.
+  std::cout << "Running " << io_threads << " I/O thread(s)." << std::endl;
+  std::vector<std::thread> io_pool;
+  for (size_t i = 1; i < io_threads; i++) {
+    io_pool.push_back(std::thread(&AsioServer::run, &s));
+  }
   s.run();
-  video_broadcast_thread.join();
-  depth_broadcast_thread.join();
+  for (std::thread& io_thread : io_pool) io_thread.join();
+
+  for (std::thread& broadcast_thread : broadcast_threads) {
+    broadcast_thread.join();
+  }
+  stats_thread.join();
 }
 
 void BroadcastServer::Stop() {
   std::cout << "Shutting down BroadcastServer...." << std::endl;
   s.stop_listening();
 
-  device.StopVideo();
-  device.StopDepth();
-
   std::cout << "Closing connections..." << std::endl;
   CloseConnections("Goodbye!");
   std::cout << "Stopping channel broadcasts..." << std::endl;
-  StopAllChannelBroadcasts();
+  ChannelMap::iterator iter;
+  for (iter = channels.begin(); iter != channels.end(); ++iter) {
+    iter->second.Close();
+  }
+  DeviceMap::iterator device;
+  for (device = devices.begin(); device != devices.end(); ++device) {
+    device->second->Shutdown();
+  }
 }
 
 }  // namespace lptc_coderdojo
\ No newline at end of file
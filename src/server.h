@@ -4,8 +4,11 @@
 #include "channel.h"
 #include "device.h"
 #include "publisher.h"
+#include "recorder.h"
+#include "worker_pool.h"
 
-#include <future>
+#include <chrono>
+#include <map>
 #include <set>
 
 #include <websocketpp/config/asio_no_tls.hpp>
@@ -18,10 +21,44 @@ typedef std::set<websocketpp::connection_hdl,
                  std::owner_less<websocketpp::connection_hdl>>
     ConnectionSet;
 
+// Devices served by one BroadcastServer, keyed by their libfreenect index.
+typedef std::map<int, lptc_coderdojo::KinectDevice*> DeviceMap;
+
+// Topic of one of a device's streams, e.g. "kinect0/depth".
+std::string GetDeviceTopic(int index, const std::string& stream);
+
+// Threads running the websocket I/O loop when none are asked for.
+const size_t kMaxDefaultIoThreads = 4;
+// Threads sharing one frame's transform when none are asked for.
+const size_t kMaxDefaultTransformThreads = 4;
+
+// Reserved topic whose subscribers get the server's metrics as a text
+// message every kStatsInterval, in the format of the HTTP endpoint.
+const char kStatsTopic[] = "stats";
+const std::chrono::seconds kStatsInterval(1);
+// Resource a plain HTTP GET scrapes the metrics from.
+const char kMetricsResource[] = "/metrics";
+
 class BroadcastServer {
  public:
-  BroadcastServer(lptc_coderdojo::KinectDevice& _device, const int _port);
+  // Serves a `video`, a `depth` and an `rgbd` channel per device, all on one
+  // I/O loop and one transform pool. The plain `video`, `depth` and `rgbd`
+  // topics stay as aliases for the first device's channels. Metrics of every
+  // channel are served over HTTP at kMetricsResource and on kStatsTopic.
+  //
+  // With `_io_threads` at 0, uses one I/O thread per core up to
+  // kMaxDefaultIoThreads. `_transform_threads` caps the threads working on
+  // one frame, the publisher's own included; at 0 it uses the cores left
+  // over by the I/O threads, up to kMaxDefaultTransformThreads.
+  BroadcastServer(const lptc_coderdojo::DeviceMap& _devices, const int _port,
+                  const size_t _io_threads = 0,
+                  const size_t _transform_threads = 0);
 
+  // Records every device's depth and video channel, as `depth_variant` and
+  // `video_variant`, through `recorder`. Call before Run.
+  void Record(lptc_coderdojo::FrameRecorder* recorder,
+              const lptc_coderdojo::StreamVariant& depth_variant,
+              const lptc_coderdojo::StreamVariant& video_variant);
   void Run();
   void Stop();
 
@@ -29,26 +66,36 @@ class BroadcastServer {
   void BroadcastToChannel(const std::string ch_name,
                           lptc_coderdojo::Publisher& publisher);
   void CloseConnections(const std::string& reason);
+  // Renders every device channel's metrics for the stats channel and the
+  // HTTP endpoint.
+  std::string FormatMetrics();
   lptc_coderdojo::Channel* GetChannel(const std::string& topic);
   void OnConnectionClosed(websocketpp::connection_hdl hdl);
   void OnConnectionOpened(websocketpp::connection_hdl hdl);
+  void OnHttpRequest(websocketpp::connection_hdl hdl);
   void OnMessage(websocketpp::connection_hdl hdl, AsioServer::message_ptr msg);
-  void RegisterChannel(const std::string& name);
+  void PublishStats();
+  void RegisterChannel(const std::string& name,
+                       const lptc_coderdojo::EncodingList& encodings);
   void SendErrorMessage(websocketpp::connection_hdl hdl,
                         const std::string& error_msg);
-  void StopAllChannelBroadcasts();
 
   typedef std::map<std::string, lptc_coderdojo::Channel> ChannelMap;
+  typedef std::map<std::string, std::string> AliasMap;
 
   const int port;
-
-  std::promise<void> term_sig;
-  std::future<void> term_future;
+  const size_t io_threads;
+  const size_t transform_threads;
 
   AsioServer s;
-  lptc_coderdojo::KinectDevice& device;
+  lptc_coderdojo::DeviceMap devices;
+  lptc_coderdojo::FrameRecorder* recorder;
+  lptc_coderdojo::StreamVariant record_depth;
+  lptc_coderdojo::StreamVariant record_video;
 
+  // Both are filled in before any broadcast starts and only read after.
   ChannelMap channels;
+  AliasMap aliases;
   ConnectionSet connections;
   std::mutex connections_lock;
 };
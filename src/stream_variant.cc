@@ -0,0 +1,145 @@
+#include "stream_variant.h"
+
+#include "config.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <tuple>
+
+namespace {
+
+const int kMaxScale = 8;
+const int kDefaultJpegQuality = 75;
+// Larger than any frame the device produces; only bounds the arithmetic.
+const int kMaxRoiCoordinate = 4096;
+
+// Parses "x,y,width,height".
+bool ParseRoiParam(const std::string& value, lptc_coderdojo::Roi* roi) {
+  std::istringstream iss(value);
+  std::string field;
+  int fields[4];
+  int count = 0;
+
+  if (value.empty() || value[value.size() - 1] == ',') return false;
+  while (std::getline(iss, field, ',')) {
+    if (count == 4 || !lptc_coderdojo::ParseIntValue(
+                          field, 0, kMaxRoiCoordinate, &fields[count]))
+      return false;
+    count++;
+  }
+  if (count != 4 || fields[2] == 0 || fields[3] == 0) return false;
+
+  roi->x = fields[0];
+  roi->y = fields[1];
+  roi->width = fields[2];
+  roi->height = fields[3];
+  return true;
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+StreamVariant::StreamVariant()
+    : encoding(Encoding::RGBA),
+      fps(0),
+      scale(1),
+      filter(ScaleFilter::NEAREST),
+      roi({0, 0, 0, 0}),
+      quality(0) {}
+
+bool StreamVariant::operator==(const StreamVariant& other) const {
+  return encoding == other.encoding && fps == other.fps &&
+         scale == other.scale && filter == other.filter &&
+         roi.x == other.roi.x && roi.y == other.roi.y &&
+         roi.width == other.roi.width && roi.height == other.roi.height &&
+         quality == other.quality;
+}
+
+bool StreamVariant::operator!=(const StreamVariant& other) const {
+  return !(*this == other);
+}
+
+bool StreamVariant::operator<(const StreamVariant& other) const {
+  return std::make_tuple(encoding, fps, scale, filter, roi.x, roi.y,
+                         roi.width, roi.height, quality) <
+         std::make_tuple(other.encoding, other.fps, other.scale, other.filter,
+                         other.roi.x, other.roi.y, other.roi.width,
+                         other.roi.height, other.quality);
+}
+
+std::string StreamVariant::ToString() const {
+  std::ostringstream oss;
+  oss << "format=" << EncodingName(encoding) << " fps=" << fps
+      << " scale=" << scale;
+  if (filter == ScaleFilter::BOX) oss << " filter=box";
+  if (!roi.IsEmpty()) {
+    oss << " roi=" << roi.x << "," << roi.y << "," << roi.width << ","
+        << roi.height;
+  }
+  if (quality) oss << " quality=" << quality;
+  return oss.str();
+}
+
+bool StreamVariant::FromParams(const Command::Params& params,
+                               StreamVariant* variant, std::string* error) {
+  StreamVariant result;
+
+  Command::Params::const_iterator iter;
+  for (iter = params.begin(); iter != params.end(); ++iter) {
+    const std::string& key = iter->first;
+    const std::string& value = iter->second;
+
+    if (key == "format") {
+      if (!EncodingFromName(value, &result.encoding)) {
+        *error = "Unknown format `" + value + "`.";
+        return false;
+      }
+    } else if (key == "fps") {
+      if (!ParseIntValue(value, 1, kMaxFps, &result.fps)) {
+        *error = "fps must be between 1 and " + std::to_string(kMaxFps) + ".";
+        return false;
+      }
+    } else if (key == "scale") {
+      if (!ParseIntValue(value, 1, kMaxScale, &result.scale)) {
+        *error =
+            "scale must be between 1 and " + std::to_string(kMaxScale) + ".";
+        return false;
+      }
+    } else if (key == "filter") {
+      if (value == "nearest") {
+        result.filter = ScaleFilter::NEAREST;
+      } else if (value == "box") {
+        result.filter = ScaleFilter::BOX;
+      } else {
+        *error = "filter must be `nearest` or `box`.";
+        return false;
+      }
+    } else if (key == "roi") {
+      if (!ParseRoiParam(value, &result.roi)) {
+        *error = "roi must be x,y,width,height with a non-empty size.";
+        return false;
+      }
+    } else if (key == "quality") {
+      if (!ParseIntValue(value, 1, 100, &result.quality)) {
+        *error = "quality must be between 1 and 100.";
+        return false;
+      }
+    } else {
+      *error = "Unknown parameter `" + key + "`.";
+      return false;
+    }
+  }
+
+  if (result.encoding == Encoding::JPEG && result.quality == 0) {
+    result.quality = kDefaultJpegQuality;
+  } else if (result.encoding != Encoding::JPEG && result.quality != 0) {
+    *error = "quality only applies to format=jpeg.";
+    return false;
+  }
+
+  *variant = result;
+  return true;
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,55 @@
+#ifndef LPTC_CODERDOJO_STREAM_VARIANT_H_
+#define LPTC_CODERDOJO_STREAM_VARIANT_H_
+
+#include "command.h"
+#include "encoding.h"
+
+#include <string>
+
+namespace lptc_coderdojo {
+
+// How a variant is reduced when `scale` is above 1.
+enum class ScaleFilter { NEAREST, BOX };
+
+// Rectangle of the device frame, in full resolution pixels. An empty
+// rectangle means the whole frame.
+struct Roi {
+  bool IsEmpty() const { return width == 0 || height == 0; }
+
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// The form of a channel's stream a subscriber asked for. Subscribers asking
+// for the same variant share one transformed and serialized frame.
+struct StreamVariant {
+  StreamVariant();
+
+  bool operator==(const StreamVariant& other) const;
+  bool operator!=(const StreamVariant& other) const;
+  bool operator<(const StreamVariant& other) const;
+  std::string ToString() const;
+
+  // Builds a variant from SUBSCRIBE parameters (format, fps, scale, filter,
+  // roi, quality). Returns
+  // false and sets `error` for unknown keys or out-of-range values.
+  static bool FromParams(const Command::Params& params, StreamVariant* variant,
+                         std::string* error);
+
+  Encoding encoding;
+  // Maximum frames per second, or 0 for every frame the device produces.
+  int fps;
+  // Integer downscale factor applied to both dimensions.
+  int scale;
+  ScaleFilter filter;
+  // Cropped before scaling. Clamped to the frame by the publisher.
+  Roi roi;
+  // JPEG quality from 1 to 100, 0 for lossless encodings.
+  int quality;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_STREAM_VARIANT_H_
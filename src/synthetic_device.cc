@@ -0,0 +1,360 @@
+#include "synthetic_device.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kDepthWidth = 640;
+const int kDepthHeight = 480;
+const int kDefaultFps = 30;
+// Columns on the right edge without readings, as on the real sensor.
+const int kDepthDeadColumns = 8;
+const uint16_t kNoReading11Bit = 2047;
+const uint16_t kNoReadingMm = 0;
+const double kWallDistanceMm = 4000;
+const double kNearestFloorMm = 800;
+const double kBallDepthMm = 150;
+// Share of the ball radius the IR projector's shadow sticks out by.
+const double kShadowShift = 0.2;
+const double kPi = 3.14159265358979323846;
+
+struct Ball {
+  // Centre and radius as fractions of the frame height, so the balls are
+  // round and line up in depth and video frames of any size.
+  double x;
+  double y;
+  double radius;
+  double distance_mm;
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+};
+
+const int kBalls = 2;
+
+// The far ball first, so the near one is drawn over it.
+void GetBalls(uint32_t frame, Ball balls[kBalls]) {
+  double angle = 2 * kPi * (frame % 90) / 90.0;
+  balls[0] = {0.667 + 0.25 * std::cos(angle), 0.35 + 0.12 * std::sin(angle),
+              0.08, 2300 + 400 * std::sin(angle), 40, 120, 230};
+
+  double sweep = (frame % 120) / 60.0;
+  if (sweep > 1) sweep = 2 - sweep;
+  balls[1] = {0.25 + 0.83 * sweep, 0.62, 0.12, 1500, 220, 60, 40};
+}
+
+uint32_t Hash(uint32_t a, uint32_t b, uint32_t c) {
+  uint32_t h = a * 0x9E3779B1u ^ b * 0x85EBCA77u ^ c * 0xC2B2AE3Du;
+  h ^= h >> 15;
+  h *= 0x2C1B3C6Du;
+  h ^= h >> 12;
+  h *= 0x297A2D39u;
+  h ^= h >> 15;
+  return h;
+}
+
+// Uniform in [-1, 1].
+double NoiseFromHash(uint32_t hash) { return (hash & 0xFFFF) / 32767.5 - 1; }
+
+// Inverse of the usual disparity to distance fit for the Kinect.
+uint16_t MmToRaw11(double mm) {
+  double raw = (1000 / mm - 3.3309495161) / -0.0030711016;
+  return static_cast<uint16_t>(std::min(std::max(raw, 0.0), 2046.0));
+}
+
+uint8_t ClampToByte(double value) {
+  return static_cast<uint8_t>(std::min(std::max(value, 0.0), 255.0));
+}
+
+double BackgroundDistanceMm(double v) {
+  if (v < 0.5) return kWallDistanceMm;
+  return kWallDistanceMm - (v - 0.5) * 2 * (kWallDistanceMm - kNearestFloorMm);
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+void RenderSyntheticDepth(int seed, uint32_t frame, DepthFormat format,
+                          int width, int height, uint16_t* depth) {
+  Ball balls[kBalls];
+  GetBalls(frame, balls);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      double mm = BackgroundDistanceMm(static_cast<double>(y) / height);
+      bool shadow = false;
+      for (const Ball& ball : balls) {
+        double r = ball.radius * height;
+        double dx = x - ball.x * height;
+        double dy = y - ball.y * height;
+        double d2 = dx * dx + dy * dy;
+        if (d2 < r * r) {
+          mm = ball.distance_mm - std::sqrt(1 - d2 / (r * r)) * kBallDepthMm;
+          shadow = false;
+        } else {
+          double sx = dx - kShadowShift * r;
+          if (sx * sx + dy * dy < r * r) shadow = true;
+        }
+      }
+
+      size_t i = static_cast<size_t>(y) * width + x;
+      uint32_t hash = Hash(seed, frame, i);
+      // Noise grows with the square of the distance, 2.5 mm at a metre.
+      double metres = mm / 1000;
+      mm += NoiseFromHash(hash) * 2.5 * metres * metres;
+      bool no_reading =
+          shadow || x >= width - kDepthDeadColumns || (hash >> 16) % 100 == 0;
+
+      if (format == DepthFormat::RAW11) {
+        depth[i] = no_reading ? kNoReading11Bit : MmToRaw11(mm);
+      } else {
+        depth[i] = no_reading ? kNoReadingMm : static_cast<uint16_t>(mm);
+      }
+    }
+  }
+}
+
+void RenderSyntheticVideo(int seed, uint32_t frame, VideoFormat format,
+                          int width, int height, uint8_t* video) {
+  Ball balls[kBalls];
+  GetBalls(frame, balls);
+  int cell = std::max(width / 16, 1);
+
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      double shade = ((x / cell + y / cell) % 2) ? 1.0 : 0.6;
+      double red = 255.0 * x / width * shade;
+      double green = 255.0 * y / height * shade;
+      double blue = 128 * shade;
+      for (const Ball& ball : balls) {
+        double r = ball.radius * height;
+        double dx = x - ball.x * height;
+        double dy = y - ball.y * height;
+        double d2 = dx * dx + dy * dy;
+        if (d2 < r * r) {
+          double lit = 0.5 + 0.5 * std::sqrt(1 - d2 / (r * r));
+          red = ball.red * lit;
+          green = ball.green * lit;
+          blue = ball.blue * lit;
+        }
+      }
+
+      size_t i = static_cast<size_t>(y) * width + x;
+      double noise = NoiseFromHash(Hash(seed, frame, i)) * 4;
+      uint8_t r8 = ClampToByte(red + noise);
+      uint8_t g8 = ClampToByte(green + noise);
+      uint8_t b8 = ClampToByte(blue + noise);
+      if (format == VideoFormat::IR) {
+        video[i] = (r8 * 77 + g8 * 150 + b8 * 29) >> 8;
+      } else {
+        video[i * 3] = r8;
+        video[i * 3 + 1] = g8;
+        video[i * 3 + 2] = b8;
+      }
+    }
+  }
+}
+
+SyntheticKinectDevice::SyntheticKinectDevice(int _index,
+                                             const DeviceConfig& _config)
+    : index(_index),
+      config(_config),
+      frame_interval(
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::seconds(1)) /
+          (config.max_fps ? config.max_fps : kDefaultFps)),
+      video_width(config.video_resolution == Resolution::HIGH ? 1280 : 640),
+      video_height(config.video_resolution == Resolution::HIGH
+                       ? 1024
+                       : config.video_format == VideoFormat::IR ? 488 : 480),
+      depth_pool(kDefaultFrameQueueDepth + kFramesInFlight,
+                 kDepthWidth * kDepthHeight),
+      video_pool(kDefaultFrameQueueDepth + kFramesInFlight,
+                 video_width * video_height *
+                     GetVideoChannels(config.video_format)),
+      depth_frames(kDefaultFrameQueueDepth),
+      video_frames(kDefaultFrameQueueDepth),
+      synchronizer(config.sync_tolerance),
+      queue_depth(false),
+      queue_video(false),
+      sync_frames(false),
+      shut_down(false),
+      renderer(&SyntheticKinectDevice::Run, this) {}
+
+SyntheticKinectDevice::~SyntheticKinectDevice() {
+  Shutdown();
+  renderer.join();
+}
+
+int SyntheticKinectDevice::GetDepthFrameWidth() { return kDepthWidth; }
+
+int SyntheticKinectDevice::GetDepthFrameHeight() { return kDepthHeight; }
+
+int SyntheticKinectDevice::GetDepthFrameRectSize() {
+  return kDepthWidth * kDepthHeight;
+}
+
+int SyntheticKinectDevice::GetVideoFrameWidth() { return video_width; }
+
+int SyntheticKinectDevice::GetVideoFrameHeight() { return video_height; }
+
+int SyntheticKinectDevice::GetVideoFrameRectSize() {
+  return video_width * video_height;
+}
+
+VideoFormat SyntheticKinectDevice::GetVideoFormat() {
+  return config.video_format;
+}
+
+DepthFormat SyntheticKinectDevice::GetDepthFormat() {
+  return config.depth_format;
+}
+
+bool SyntheticKinectDevice::GetNextDepthFrame(DepthFramePtr& frame) {
+  return depth_frames.Pop(frame);
+}
+
+bool SyntheticKinectDevice::GetNextVideoFrame(VideoFramePtr& frame) {
+  return video_frames.Pop(frame);
+}
+
+bool SyntheticKinectDevice::GetNextRgbdFrame(RgbdFrame& pair) {
+  return synchronizer.Pop(pair);
+}
+
+void SyntheticKinectDevice::StartDepth() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    queue_depth = true;
+  }
+  run_cond.notify_all();
+}
+
+void SyntheticKinectDevice::StartVideo() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    queue_video = true;
+  }
+  run_cond.notify_all();
+}
+
+void SyntheticKinectDevice::StartRgbd() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    sync_frames = true;
+  }
+  run_cond.notify_all();
+}
+
+void SyntheticKinectDevice::StopDepth() {
+  queue_depth = false;
+  depth_frames.Clear();
+}
+
+void SyntheticKinectDevice::StopVideo() {
+  queue_video = false;
+  video_frames.Clear();
+}
+
+void SyntheticKinectDevice::StopRgbd() {
+  sync_frames = false;
+  synchronizer.Clear();
+}
+
+void SyntheticKinectDevice::Shutdown() {
+  {
+    std::lock_guard<std::mutex> guard(run_lock);
+    shut_down = true;
+  }
+  run_cond.notify_all();
+  depth_frames.Close();
+  video_frames.Close();
+  synchronizer.Close();
+}
+
+StreamStats SyntheticKinectDevice::GetDepthStats() {
+  return {depth_frames.GetSize(),
+          depth_frames.GetDroppedFrames() + depth_pool.GetMisses()};
+}
+
+StreamStats SyntheticKinectDevice::GetVideoStats() {
+  return {video_frames.GetSize(),
+          video_frames.GetDroppedFrames() + video_pool.GetMisses()};
+}
+
+StreamStats SyntheticKinectDevice::GetRgbdStats() {
+  return {synchronizer.GetPendingPairs(), synchronizer.GetDroppedPairs()};
+}
+
+void SyntheticKinectDevice::Run() {
+  std::chrono::steady_clock::time_point due = std::chrono::steady_clock::now();
+  uint32_t frame_number = 0;
+
+  std::unique_lock<std::mutex> lock(run_lock);
+  for (;;) {
+    if (!queue_depth && !queue_video && !sync_frames) {
+      run_cond.wait(lock, [this] {
+        return shut_down || queue_depth || queue_video || sync_frames;
+      });
+      // Start ticking again from the first consumer rather than catching up.
+      due = std::chrono::steady_clock::now();
+    }
+    if (run_cond.wait_until(lock, due, [this] { return shut_down; })) return;
+    lock.unlock();
+    // Both cameras expose at the tick, however long rendering takes.
+    std::chrono::system_clock::time_point capture_time =
+        std::chrono::system_clock::now();
+    RenderDepth(frame_number, capture_time);
+    RenderVideo(frame_number, capture_time);
+    lock.lock();
+
+    // The scene moves with time, so frames that could not be rendered in
+    // time are skipped rather than delivered late.
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    do {
+      due += frame_interval;
+      frame_number++;
+    } while (due < now);
+  }
+}
+
+void SyntheticKinectDevice::RenderDepth(
+    uint32_t frame_number,
+    std::chrono::system_clock::time_point capture_time) {
+  bool queued = queue_depth.load();
+  bool synced = sync_frames.load();
+  if (!queued && !synced) return;
+  DepthFramePtr frame = depth_pool.Acquire();
+  if (!frame) return;
+
+  RenderSyntheticDepth(index, frame_number, config.depth_format, kDepthWidth,
+                       kDepthHeight, frame->data.data());
+  frame->timestamp = frame_number;
+  frame->capture_time = capture_time;
+  frame->queued_time = std::chrono::system_clock::now();
+  if (synced) synchronizer.AddDepth(frame);
+  if (queued) depth_frames.Push(std::move(frame));
+}
+
+void SyntheticKinectDevice::RenderVideo(
+    uint32_t frame_number,
+    std::chrono::system_clock::time_point capture_time) {
+  bool queued = queue_video.load();
+  bool synced = sync_frames.load();
+  if (!queued && !synced) return;
+  VideoFramePtr frame = video_pool.Acquire();
+  if (!frame) return;
+
+  RenderSyntheticVideo(index, frame_number, config.video_format, video_width,
+                       video_height, frame->data.data());
+  frame->timestamp = frame_number;
+  frame->capture_time = capture_time;
+  frame->queued_time = std::chrono::system_clock::now();
+  if (synced) synchronizer.AddVideo(frame);
+  if (queued) video_frames.Push(std::move(frame));
+}
+
+}  // namespace lptc_coderdojo
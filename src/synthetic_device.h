@@ -0,0 +1,97 @@
+#ifndef LPTC_CODERDOJO_SYNTHETIC_DEVICE_H_
+#define LPTC_CODERDOJO_SYNTHETIC_DEVICE_H_
+
+#include "config.h"
+#include "device.h"
+#include "frame.h"
+#include "frame_queue.h"
+#include "frame_synchronizer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace lptc_coderdojo {
+
+// Renders frame number `frame` of the synthetic scene: a wall and a floor
+// sloping towards the camera, with two balls moving in front of them. Depth
+// has sensor-like noise, dropouts and shadows beside the balls, in the units
+// of `format` and with its "no reading" value. The output depends only on
+// the arguments, so the same frame can be rendered again from the device
+// timestamp it was published with. `seed` varies the noise between devices.
+void RenderSyntheticDepth(int seed, uint32_t frame, DepthFormat format,
+                          int width, int height, uint16_t* depth);
+// Video is a colour checkerboard with the same balls, or its brightness for
+// IR. BAYER is rendered as RGB, like OpenKinectDevice hands it on.
+void RenderSyntheticVideo(int seed, uint32_t frame, VideoFormat format,
+                          int width, int height, uint8_t* video);
+
+// A device that needs no hardware, for load testing the server. A thread
+// renders both streams at `config.max_fps`, or 30 fps when it is 0, in the
+// configured resolution and formats. Rendering stops while no consumer is
+// started.
+class SyntheticKinectDevice : public KinectDevice {
+ public:
+  typedef FramePool<uint16_t> DepthFramePool;
+  typedef FramePool<uint8_t> VideoFramePool;
+  typedef FrameQueue<uint16_t> DepthFrameQueue;
+  typedef FrameQueue<uint8_t> VideoFrameQueue;
+
+  SyntheticKinectDevice(int index, const lptc_coderdojo::DeviceConfig& config);
+  ~SyntheticKinectDevice();
+
+  int GetDepthFrameWidth();
+  int GetDepthFrameHeight();
+  int GetDepthFrameRectSize();
+  int GetVideoFrameWidth();
+  int GetVideoFrameHeight();
+  int GetVideoFrameRectSize();
+  lptc_coderdojo::VideoFormat GetVideoFormat();
+  lptc_coderdojo::DepthFormat GetDepthFormat();
+  bool GetNextDepthFrame(DepthFramePtr&);
+  bool GetNextVideoFrame(VideoFramePtr&);
+  bool GetNextRgbdFrame(RgbdFrame&);
+  void StartDepth();
+  void StartVideo();
+  void StartRgbd();
+  void StopDepth();
+  void StopVideo();
+  void StopRgbd();
+  void Shutdown();
+  lptc_coderdojo::StreamStats GetDepthStats();
+  lptc_coderdojo::StreamStats GetVideoStats();
+  lptc_coderdojo::StreamStats GetRgbdStats();
+
+ private:
+  void Run();
+  void RenderDepth(uint32_t frame_number,
+                   std::chrono::system_clock::time_point capture_time);
+  void RenderVideo(uint32_t frame_number,
+                   std::chrono::system_clock::time_point capture_time);
+
+  const int index;
+  const lptc_coderdojo::DeviceConfig config;
+  const std::chrono::steady_clock::duration frame_interval;
+  const int video_width;
+  const int video_height;
+
+  DepthFramePool depth_pool;
+  VideoFramePool video_pool;
+  DepthFrameQueue depth_frames;
+  VideoFrameQueue video_frames;
+  FrameSynchronizer synchronizer;
+
+  std::atomic<bool> queue_depth;
+  std::atomic<bool> queue_video;
+  std::atomic<bool> sync_frames;
+  bool shut_down;
+  std::mutex run_lock;
+  std::condition_variable run_cond;
+  std::thread renderer;
+};
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_SYNTHETIC_DEVICE_H_
@@ -0,0 +1,324 @@
+#include "transform.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LPTC_CODERDOJO_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void DepthToRgbaScalar(const uint16_t* depth, uint8_t* rgba, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) {
+    uint8_t val = (uint8_t)depth[i];
+    rgba[i * 4] = 255 - val;
+    rgba[i * 4 + 1] = 255 - val;
+    rgba[i * 4 + 2] = 255 - val;
+    rgba[i * 4 + 3] = 255;
+  }
+}
+
+void RgbToRgbaScalar(const uint8_t* rgb, uint8_t* rgba, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) {
+    rgba[i * 4] = rgb[i * 3];
+    rgba[i * 4 + 1] = rgb[i * 3 + 1];
+    rgba[i * 4 + 2] = rgb[i * 3 + 2];
+    rgba[i * 4 + 3] = 255;
+  }
+}
+
+#ifdef LPTC_CODERDOJO_X86_KERNELS
+
+// 16 pixels per iteration: keep the low byte of each sample, invert it and
+// interleave it three times with an opaque alpha byte.
+__attribute__((target("sse2"))) void DepthToRgbaSse2(const uint16_t* depth,
+                                                      uint8_t* rgba,
+                                                      size_t pixels) {
+  const __m128i low_byte = _mm_set1_epi16(0x00FF);
+  const __m128i ones = _mm_set1_epi8(-1);
+
+  size_t i = 0;
+  for (; i + 16 <= pixels; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + i));
+    __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + i + 8));
+    __m128i v = _mm_packus_epi16(_mm_and_si128(a, low_byte),
+                                 _mm_and_si128(b, low_byte));
+    v = _mm_xor_si128(v, ones);
+
+    __m128i lo = _mm_unpacklo_epi8(v, v);
+    __m128i hi = _mm_unpackhi_epi8(v, v);
+    __m128i lo_alpha = _mm_unpacklo_epi8(v, ones);
+    __m128i hi_alpha = _mm_unpackhi_epi8(v, ones);
+
+    __m128i* out = reinterpret_cast<__m128i*>(rgba + i * 4);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(lo, lo_alpha));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, lo_alpha));
+    _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, hi_alpha));
+    _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, hi_alpha));
+  }
+  DepthToRgbaScalar(depth + i, rgba + i * 4, pixels - i);
+}
+
+// 4 pixels per iteration. Each load reads 16 bytes but only uses 12, so stop
+// while a full load still fits in the input.
+__attribute__((target("ssse3"))) void RgbToRgbaSsse3(const uint8_t* rgb,
+                                                      uint8_t* rgba,
+                                                      size_t pixels) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+  size_t i = 0;
+  for (; i + 6 <= pixels; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + i * 3));
+    v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), v);
+  }
+  RgbToRgbaScalar(rgb + i * 3, rgba + i * 4, pixels - i);
+}
+
+// 32 pixels per iteration. AVX2 packs and unpacks work within 128-bit lanes,
+// so the packed bytes are put back in order before expanding and the
+// expanded quarters are recombined across lanes on store.
+__attribute__((target("avx2"))) void DepthToRgbaAvx2(const uint16_t* depth,
+                                                      uint8_t* rgba,
+                                                      size_t pixels) {
+  const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+  const __m256i ones = _mm256_set1_epi8(-1);
+
+  size_t i = 0;
+  for (; i + 32 <= pixels; i += 32) {
+    __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(depth + i));
+    __m256i b =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(depth + i + 16));
+    __m256i v = _mm256_packus_epi16(_mm256_and_si256(a, low_byte),
+                                    _mm256_and_si256(b, low_byte));
+    v = _mm256_permute4x64_epi64(v, 0xD8);
+    v = _mm256_xor_si256(v, ones);
+
+    __m256i lo = _mm256_unpacklo_epi8(v, v);
+    __m256i hi = _mm256_unpackhi_epi8(v, v);
+    __m256i lo_alpha = _mm256_unpacklo_epi8(v, ones);
+    __m256i hi_alpha = _mm256_unpackhi_epi8(v, ones);
+
+    // Lane 0 holds pixels 0-15 and lane 1 pixels 16-31 of each quarter.
+    __m256i q0 = _mm256_unpacklo_epi16(lo, lo_alpha);
+    __m256i q1 = _mm256_unpackhi_epi16(lo, lo_alpha);
+    __m256i q2 = _mm256_unpacklo_epi16(hi, hi_alpha);
+    __m256i q3 = _mm256_unpackhi_epi16(hi, hi_alpha);
+
+    __m256i* out = reinterpret_cast<__m256i*>(rgba + i * 4);
+    _mm256_storeu_si256(out, _mm256_permute2x128_si256(q0, q1, 0x20));
+    _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(q2, q3, 0x20));
+    _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(q0, q1, 0x31));
+    _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(q2, q3, 0x31));
+  }
+  DepthToRgbaSse2(depth + i, rgba + i * 4, pixels - i);
+}
+
+// 8 pixels per iteration, 4 per lane. The upper lane is loaded 12 bytes
+// after the lower one so the same in-lane shuffle serves both.
+__attribute__((target("avx2"))) void RgbToRgbaAvx2(const uint8_t* rgb,
+                                                    uint8_t* rgba,
+                                                    size_t pixels) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4,
+      5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+  size_t i = 0;
+  for (; i + 10 <= pixels; i += 8) {
+    const uint8_t* in = rgb + i * 3;
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12));
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), v);
+  }
+  RgbToRgbaSsse3(rgb + i * 3, rgba + i * 4, pixels - i);
+}
+
+#endif  // LPTC_CODERDOJO_X86_KERNELS
+
+std::vector<lptc_coderdojo::TransformKernels> DetectTransformKernels() {
+  std::vector<lptc_coderdojo::TransformKernels> kernels;
+  kernels.push_back({"scalar", DepthToRgbaScalar, RgbToRgbaScalar});
+
+#ifdef LPTC_CODERDOJO_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("ssse3")) {
+    kernels.push_back({"sse", DepthToRgbaSse2, RgbToRgbaSsse3});
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    kernels.push_back({"avx2", DepthToRgbaAvx2, RgbToRgbaAvx2});
+  }
+#endif
+
+  return kernels;
+}
+
+}  // namespace
+
+namespace lptc_coderdojo {
+
+const std::vector<TransformKernels>& GetSupportedTransformKernels() {
+  static const std::vector<TransformKernels> kernels = DetectTransformKernels();
+  return kernels;
+}
+
+const TransformKernels& GetBestTransformKernels() {
+  static const TransformKernels& best = GetSupportedTransformKernels().back();
+  return best;
+}
+
+void TransformDepthToRgba(const uint16_t* depth, uint8_t* rgba,
+                          size_t pixels) {
+  GetBestTransformKernels().depth_to_rgba(depth, rgba, pixels);
+}
+
+void TransformRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixels) {
+  GetBestTransformKernels().rgb_to_rgba(rgb, rgba, pixels);
+}
+
+void TransformGreyToRgba(const uint8_t* grey, uint8_t* rgba, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) {
+    rgba[i * 4] = grey[i];
+    rgba[i * 4 + 1] = grey[i];
+    rgba[i * 4 + 2] = grey[i];
+    rgba[i * 4 + 3] = 255;
+  }
+}
+
+void TransformGreyToRgb(const uint8_t* grey, uint8_t* rgb, size_t pixels) {
+  for (size_t i = 0; i < pixels; i++) {
+    rgb[i * 3] = grey[i];
+    rgb[i * 3 + 1] = grey[i];
+    rgb[i * 3 + 2] = grey[i];
+  }
+}
+
+void TransformBayerToRgb(const uint8_t* bayer, int width, int height,
+                         uint8_t* rgb) {
+  size_t row_size = (size_t)width * 3;
+  for (int y = 0; y + 1 < height; y += 2) {
+    const uint8_t* top = bayer + (size_t)y * width;
+    const uint8_t* bottom = top + width;
+    uint8_t* out_top = rgb + (size_t)y * row_size;
+    uint8_t* out_bottom = out_top + row_size;
+    for (int x = 0; x + 1 < width; x += 2) {
+      uint8_t r = top[x + 1];
+      uint8_t g = (top[x] + bottom[x + 1] + 1) / 2;
+      uint8_t b = bottom[x];
+      uint8_t* cell[] = {out_top + x * 3, out_top + x * 3 + 3,
+                         out_bottom + x * 3, out_bottom + x * 3 + 3};
+      for (uint8_t* pixel : cell) {
+        pixel[0] = r;
+        pixel[1] = g;
+        pixel[2] = b;
+      }
+    }
+  }
+}
+
+template <typename T>
+void TransformDecimate(const T* in, int width, int height, int stride,
+                       int channels, int scale, T* out) {
+  int out_width = width / scale;
+  int out_height = height / scale;
+  for (int y = 0; y < out_height; y++) {
+    const T* row = in + (size_t)y * scale * stride * channels;
+    for (int x = 0; x < out_width; x++) {
+      const T* pixel = row + (size_t)x * scale * channels;
+      for (int c = 0; c < channels; c++) *out++ = pixel[c];
+    }
+  }
+}
+
+template <typename T>
+void TransformBoxDownscale(const T* in, int width, int height, int stride,
+                           int channels, int scale, T* out) {
+  int out_width = width / scale;
+  int out_height = height / scale;
+  uint32_t area = scale * scale;
+  for (int y = 0; y < out_height; y++) {
+    const T* row = in + (size_t)y * scale * stride * channels;
+    for (int x = 0; x < out_width; x++) {
+      const T* block = row + (size_t)x * scale * channels;
+      for (int c = 0; c < channels; c++) {
+        uint32_t sum = 0;
+        for (int dy = 0; dy < scale; dy++) {
+          const T* pixel = block + (size_t)dy * stride * channels + c;
+          for (int dx = 0; dx < scale; dx++) sum += pixel[dx * channels];
+        }
+        *out++ = (T)((sum + area / 2) / area);
+      }
+    }
+  }
+}
+
+void TransformDepthBoxDownscale(const uint16_t* in, int width, int height,
+                                int stride, int scale, uint16_t no_reading,
+                                uint16_t* out) {
+  int out_width = width / scale;
+  int out_height = height / scale;
+  for (int y = 0; y < out_height; y++) {
+    const uint16_t* row = in + (size_t)y * scale * stride;
+    for (int x = 0; x < out_width; x++) {
+      const uint16_t* block = row + (size_t)x * scale;
+      uint32_t sum = 0;
+      uint32_t valid = 0;
+      for (int dy = 0; dy < scale; dy++) {
+        const uint16_t* pixel = block + (size_t)dy * stride;
+        for (int dx = 0; dx < scale; dx++) {
+          if (pixel[dx] == no_reading) continue;
+          sum += pixel[dx];
+          valid++;
+        }
+      }
+      *out++ = valid ? (uint16_t)((sum + valid / 2) / valid) : no_reading;
+    }
+  }
+}
+
+template void TransformDecimate<uint8_t>(const uint8_t*, int, int, int, int,
+                                         int, uint8_t*);
+template void TransformDecimate<uint16_t>(const uint16_t*, int, int, int, int,
+                                          int, uint16_t*);
+template void TransformBoxDownscale<uint8_t>(const uint8_t*, int, int, int,
+                                             int, int, uint8_t*);
+template void TransformBoxDownscale<uint16_t>(const uint16_t*, int, int, int,
+                                              int, int, uint16_t*);
+
+size_t GetPacked11Size(size_t pixels) { return (pixels * 11 + 7) / 8; }
+
+void TransformDepthToPacked11(const uint16_t* depth, uint8_t* packed,
+                              size_t pixels) {
+  uint32_t bits = 0;
+  int bit_count = 0;
+  for (size_t i = 0; i < pixels; i++) {
+    bits = (bits << 11) | (depth[i] & 0x7FF);
+    bit_count += 11;
+    while (bit_count >= 8) {
+      bit_count -= 8;
+      *packed++ = (uint8_t)(bits >> bit_count);
+    }
+  }
+  if (bit_count > 0) *packed = (uint8_t)(bits << (8 - bit_count));
+}
+
+void TransformPacked11ToDepth(const uint8_t* packed, uint16_t* depth,
+                              size_t pixels) {
+  uint32_t bits = 0;
+  int bit_count = 0;
+  for (size_t i = 0; i < pixels; i++) {
+    while (bit_count < 11) {
+      bits = (bits << 8) | *packed++;
+      bit_count += 8;
+    }
+    bit_count -= 11;
+    depth[i] = (bits >> bit_count) & 0x7FF;
+  }
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,72 @@
+#ifndef LPTC_CODERDOJO_TRANSFORM_H_
+#define LPTC_CODERDOJO_TRANSFORM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+typedef void (*DepthToRgbaFn)(const uint16_t* depth, uint8_t* rgba,
+                              size_t pixels);
+typedef void (*RgbToRgbaFn)(const uint8_t* rgb, uint8_t* rgba, size_t pixels);
+
+// One implementation of every pixel transform for a given instruction set.
+struct TransformKernels {
+  const char* isa;
+  DepthToRgbaFn depth_to_rgba;
+  RgbToRgbaFn rgb_to_rgba;
+};
+
+// Kernels usable on the running CPU, from the scalar reference to the most
+// capable one. All of them produce byte-identical output.
+const std::vector<TransformKernels>& GetSupportedTransformKernels();
+const TransformKernels& GetBestTransformKernels();
+
+// Converts the low byte of each depth sample to an inverted grey RGBA pixel.
+void TransformDepthToRgba(const uint16_t* depth, uint8_t* rgba, size_t pixels);
+// Expands packed RGB pixels to RGBA with an opaque alpha channel.
+void TransformRgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixels);
+// Expands single sample pixels to grey RGBA with an opaque alpha channel.
+void TransformGreyToRgba(const uint8_t* grey, uint8_t* rgba, size_t pixels);
+void TransformGreyToRgb(const uint8_t* grey, uint8_t* rgb, size_t pixels);
+// Demosaics the Kinect's GRBG Bayer pattern to packed RGB by giving every
+// pixel of a 2x2 cell the cell's red, blue and mean green. Much cheaper than
+// libfreenect's interpolation, at the cost of blockier edges. `width` and
+// `height` must be even.
+void TransformBayerToRgb(const uint8_t* bayer, int width, int height,
+                         uint8_t* rgb);
+
+// Downscaling stages. Both read a `width` x `height` window of an image
+// whose rows are `stride` pixels apart, so a region of interest is cropped
+// by offsetting `in` with no extra copy, and write a packed
+// (width / scale) x (height / scale) image. A pixel is `channels` samples.
+//
+// Keeps the first pixel of every `scale` x `scale` block. With a scale of 1
+// this is a plain crop.
+template <typename T>
+void TransformDecimate(const T* in, int width, int height, int stride,
+                       int channels, int scale, T* out);
+// Averages every `scale` x `scale` block, rounding to nearest.
+template <typename T>
+void TransformBoxDownscale(const T* in, int width, int height, int stride,
+                           int channels, int scale, T* out);
+// Box downscale for depth: samples equal to `no_reading` are left out of
+// each block's average, so edges never blend into made-up distances. Blocks
+// without a valid sample come out as `no_reading`.
+void TransformDepthBoxDownscale(const uint16_t* in, int width, int height,
+                                int stride, int scale, uint16_t no_reading,
+                                uint16_t* out);
+
+// Bytes needed to hold `pixels` 11-bit samples back to back.
+size_t GetPacked11Size(size_t pixels);
+// Packs the low 11 bits of each depth sample MSB first, 8 samples in every
+// 11 bytes. A trailing partial byte is zero padded.
+void TransformDepthToPacked11(const uint16_t* depth, uint8_t* packed,
+                              size_t pixels);
+void TransformPacked11ToDepth(const uint8_t* packed, uint16_t* depth,
+                              size_t pixels);
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_TRANSFORM_H_
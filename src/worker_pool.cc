@@ -0,0 +1,96 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace lptc_coderdojo {
+
+WorkerPool::WorkerPool(size_t threads)
+    : stopping(false),
+      generation(0),
+      busy_workers(0),
+      band_fn(NULL),
+      band_ctx(NULL),
+      band_count(0),
+      band_size(0),
+      band_total(0),
+      next_band(0) {
+  for (size_t i = 0; i < threads; i++) {
+    workers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> guard(state_lock);
+    stopping = true;
+  }
+  start_cond.notify_all();
+  for (std::thread& worker : workers) worker.join();
+}
+
+size_t WorkerPool::GetThreadCount() const { return workers.size(); }
+
+void WorkerPool::Run(BandFn fn, const void* ctx, size_t count,
+                     size_t min_band) {
+  if (count == 0) return;
+  min_band = std::max<size_t>(min_band, 1);
+
+  size_t bands = std::min(workers.size() + 1, count / min_band);
+  std::unique_lock<std::mutex> job(job_lock, std::try_to_lock);
+  if (bands <= 1 || !job.owns_lock()) {
+    fn(ctx, 0, count);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(state_lock);
+    band_fn = fn;
+    band_ctx = ctx;
+    band_count = bands;
+    band_size = (count + bands - 1) / bands;
+    band_total = count;
+    next_band = 0;
+    busy_workers = workers.size();
+    generation++;
+  }
+  start_cond.notify_all();
+
+  RunBands();
+
+  std::unique_lock<std::mutex> lock(state_lock);
+  done_cond.wait(lock, [this] { return busy_workers == 0; });
+}
+
+void WorkerPool::RunBands() {
+  size_t band;
+  while ((band = next_band++) < band_count) {
+    size_t begin = band * band_size;
+    size_t end = std::min(begin + band_size, band_total);
+    if (begin < end) band_fn(band_ctx, begin, end);
+  }
+}
+
+void WorkerPool::WorkerLoop() {
+  size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(state_lock);
+      start_cond.wait(lock, [this, seen_generation] {
+        return stopping || generation != seen_generation;
+      });
+      if (stopping) return;
+      seen_generation = generation;
+    }
+
+    RunBands();
+
+    bool last;
+    {
+      std::lock_guard<std::mutex> guard(state_lock);
+      last = --busy_workers == 0;
+    }
+    if (last) done_cond.notify_one();
+  }
+}
+
+}  // namespace lptc_coderdojo
@@ -0,0 +1,70 @@
+#ifndef LPTC_CODERDOJO_WORKER_POOL_H_
+#define LPTC_CODERDOJO_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lptc_coderdojo {
+
+// Persistent threads that split one frame's work into contiguous bands. The
+// calling thread works on bands too, so a pool of N threads uses up to N + 1
+// cores. It runs one job at a time: a caller that finds the pool busy runs
+// its whole job itself rather than waiting.
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t threads);
+  ~WorkerPool();
+
+  size_t GetThreadCount() const;
+
+  // Calls fn(begin, end) over bands covering [0, count), each at least
+  // `min_band` long except possibly the last, and returns once all of them
+  // are done.
+  template <typename Fn>
+  void ParallelFor(size_t count, size_t min_band, const Fn& fn);
+
+ private:
+  typedef void (*BandFn)(const void* ctx, size_t begin, size_t end);
+
+  template <typename Fn>
+  static void InvokeBand(const void* ctx, size_t begin, size_t end);
+
+  void Run(BandFn fn, const void* ctx, size_t count, size_t min_band);
+  void RunBands();
+  void WorkerLoop();
+
+  std::vector<std::thread> workers;
+
+  std::mutex job_lock;
+  std::mutex state_lock;
+  std::condition_variable start_cond;
+  std::condition_variable done_cond;
+  bool stopping;
+  size_t generation;
+  size_t busy_workers;
+
+  BandFn band_fn;
+  const void* band_ctx;
+  size_t band_count;
+  size_t band_size;
+  size_t band_total;
+  std::atomic<size_t> next_band;
+};
+
+template <typename Fn>
+void WorkerPool::ParallelFor(size_t count, size_t min_band, const Fn& fn) {
+  Run(&WorkerPool::InvokeBand<Fn>, &fn, count, min_band);
+}
+
+template <typename Fn>
+void WorkerPool::InvokeBand(const void* ctx, size_t begin, size_t end) {
+  (*static_cast<const Fn*>(ctx))(begin, end);
+}
+
+}  // namespace lptc_coderdojo
+
+#endif  // LPTC_CODERDOJO_WORKER_POOL_H_
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include "codec.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <jpeglib.h>
+
+namespace {
+
+std::vector<uint16_t> RoundTrip(const std::vector<uint16_t>& depth,
+                                size_t* encoded_size) {
+  std::vector<uint8_t> encoded(lptc_coderdojo::GetRvlMaxSize(depth.size()));
+  *encoded_size =
+      lptc_coderdojo::EncodeRvl(depth.data(), depth.size(), encoded.data());
+  EXPECT_LE(*encoded_size, encoded.size());
+  EXPECT_EQ(0u, *encoded_size % 4);
+
+  std::vector<uint16_t> decoded(depth.size());
+  EXPECT_TRUE(lptc_coderdojo::DecodeRvl(encoded.data(), *encoded_size,
+                                        decoded.data(), decoded.size()));
+  return decoded;
+}
+
+TEST(CodecTest, Rvl_RoundTripsRandomSamples) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> sample(0, 0xFFFF);
+  std::bernoulli_distribution no_reading(0.3);
+
+  for (size_t pixels : {0, 1, 2, 7, 1000, 640 * 480}) {
+    std::vector<uint16_t> depth(pixels);
+    for (size_t i = 0; i < pixels; i++) {
+      depth[i] = no_reading(rng) ? lptc_coderdojo::kRvlSampleKey : sample(rng);
+    }
+    size_t size;
+    EXPECT_EQ(depth, RoundTrip(depth, &size)) << pixels;
+  }
+}
+
+TEST(CodecTest, Rvl_WorstCaseFitsMaxSize) {
+  // Full range swings between every sample, with and without zeros.
+  std::vector<uint16_t> swings(1001);
+  std::vector<uint16_t> alternating(1001);
+  for (size_t i = 0; i < swings.size(); i++) {
+    swings[i] = (i % 2) ? 0xFFFF : 0x0000;
+    alternating[i] = (i % 2) ? lptc_coderdojo::kRvlSampleKey
+                             : ((i % 4) ? 0xF800 : 0x07FE);
+  }
+  size_t size;
+  EXPECT_EQ(swings, RoundTrip(swings, &size));
+  EXPECT_EQ(alternating, RoundTrip(alternating, &size));
+}
+
+TEST(CodecTest, Rvl_CompressesSmoothFrames) {
+  const int width = 640;
+  const int height = 480;
+  std::vector<uint16_t> depth(width * height);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      depth[y * width + x] =
+          (x < 40) ? lptc_coderdojo::kRvlSampleKey : 600 + x / 8 + y / 4;
+    }
+  }
+  size_t size;
+  EXPECT_EQ(depth, RoundTrip(depth, &size));
+  EXPECT_LT(size * 4, depth.size() * sizeof(uint16_t));
+}
+
+TEST(CodecTest, Rvl_RejectsTruncatedInput) {
+  std::vector<uint16_t> depth(100, 700);
+  std::vector<uint8_t> encoded(lptc_coderdojo::GetRvlMaxSize(depth.size()));
+  size_t size =
+      lptc_coderdojo::EncodeRvl(depth.data(), depth.size(), encoded.data());
+
+  std::vector<uint16_t> decoded(depth.size());
+  EXPECT_FALSE(lptc_coderdojo::DecodeRvl(encoded.data(), size - 4,
+                                         decoded.data(), decoded.size()));
+  // Fewer samples than encoded is rejected rather than overflowing.
+  EXPECT_FALSE(lptc_coderdojo::DecodeRvl(encoded.data(), size,
+                                         decoded.data(), 50));
+}
+
+std::vector<uint8_t> DecodeJpeg(const std::vector<uint8_t>& jpeg, int* width,
+                                int* height) {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr err;
+  cinfo.err = jpeg_std_error(&err);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<uint8_t*>(jpeg.data()), jpeg.size());
+  jpeg_read_header(&cinfo, TRUE);
+  cinfo.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+
+  *width = cinfo.output_width;
+  *height = cinfo.output_height;
+  std::vector<uint8_t> rgb((size_t)*width * *height * 3);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row = rgb.data() + (size_t)cinfo.output_scanline * *width * 3;
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return rgb;
+}
+
+TEST(CodecTest, Jpeg_EncodesDecodableFrames) {
+  lptc_coderdojo::JpegEncoder encoder;
+  std::vector<uint8_t> jpeg;
+
+  // A small frame first, so the second one has to grow the buffer.
+  for (int size : {16, 320}) {
+    std::vector<uint8_t> rgb((size_t)size * size * 3);
+    for (int y = 0; y < size; y++) {
+      for (int x = 0; x < size; x++) {
+        uint8_t* pixel = &rgb[((size_t)y * size + x) * 3];
+        pixel[0] = x * 255 / size;
+        pixel[1] = y * 255 / size;
+        pixel[2] = 128;
+      }
+    }
+    ASSERT_TRUE(encoder.Encode(rgb.data(), size, size, 3, 90, &jpeg));
+    ASSERT_GT(jpeg.size(), 2u);
+    EXPECT_EQ(0xFF, jpeg[0]);
+    EXPECT_EQ(0xD8, jpeg[1]);
+
+    int width, height;
+    std::vector<uint8_t> decoded = DecodeJpeg(jpeg, &width, &height);
+    ASSERT_EQ(size, width);
+    ASSERT_EQ(size, height);
+    for (size_t i = 0; i < rgb.size(); i++) {
+      ASSERT_NEAR(rgb[i], decoded[i], 24) << size << ", " << i;
+    }
+  }
+}
+
+TEST(CodecTest, Jpeg_DecoderReadsEncodedFrames) {
+  lptc_coderdojo::JpegEncoder encoder;
+  lptc_coderdojo::JpegDecoder decoder;
+  const int size = 48;
+  std::vector<uint8_t> rgb((size_t)size * size * 3, 160);
+  std::vector<uint8_t> jpeg;
+  ASSERT_TRUE(encoder.Encode(rgb.data(), size, size, 3, 90, &jpeg));
+
+  std::vector<uint8_t> decoded(rgb.size());
+  ASSERT_TRUE(
+      decoder.Decode(jpeg.data(), jpeg.size(), size, size, decoded.data()));
+  for (size_t i = 0; i < rgb.size(); i++) ASSERT_NEAR(160, decoded[i], 4);
+
+  EXPECT_FALSE(
+      decoder.Decode(jpeg.data(), jpeg.size(), size, 2 * size, decoded.data()));
+  std::vector<uint8_t> garbage(jpeg.size(), 0);
+  EXPECT_FALSE(decoder.Decode(garbage.data(), garbage.size(), size, size,
+                              decoded.data()));
+  // Still usable after failing.
+  EXPECT_TRUE(
+      decoder.Decode(jpeg.data(), jpeg.size(), size, size, decoded.data()));
+}
+
+TEST(CodecTest, Jpeg_EncodesGreyscaleFrames) {
+  lptc_coderdojo::JpegEncoder encoder;
+  std::vector<uint8_t> jpeg;
+  const int size = 64;
+  std::vector<uint8_t> grey((size_t)size * size);
+  for (size_t i = 0; i < grey.size(); i++) grey[i] = i % size * 4;
+
+  ASSERT_TRUE(encoder.Encode(grey.data(), size, size, 1, 90, &jpeg));
+  int width, height;
+  std::vector<uint8_t> decoded = DecodeJpeg(jpeg, &width, &height);
+  ASSERT_EQ(size, width);
+  ASSERT_EQ(size, height);
+  for (size_t i = 0; i < grey.size(); i++) {
+    ASSERT_NEAR(grey[i], decoded[i * 3], 8) << i;
+    ASSERT_EQ(decoded[i * 3], decoded[i * 3 + 1]) << i;
+  }
+}
+
+}  // namespace
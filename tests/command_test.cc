@@ -29,6 +29,31 @@ TEST(ServerCommandTest, FromMessagePayload_InvalidAction) {
         lptc_coderdojo::Command::FromMessagePayload("SUBSCRIBEtest_topic");
     EXPECT_EQ(lptc_coderdojo::Command::Action::INVALID, c.GetAction());
   }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE test_topic raw16");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::INVALID, c.GetAction());
+  }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE test_topic format=");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::INVALID, c.GetAction());
+  }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE test_topic format=raw16 extra");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::INVALID, c.GetAction());
+  }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE test_topic =raw16");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::INVALID, c.GetAction());
+  }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE test_topic fps=10 fps=5");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::INVALID, c.GetAction());
+  }
 }
 
 TEST(ServerCommandTest, FromMessagePayload_ValidAction) {
@@ -44,6 +69,24 @@ TEST(ServerCommandTest, FromMessagePayload_ValidAction) {
     EXPECT_EQ(lptc_coderdojo::Command::Action::UNSUBSCRIBE, c.GetAction());
     EXPECT_EQ("test_topic", c.GetTopic());
   }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE test_topic format=raw16");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::SUBSCRIBE, c.GetAction());
+    EXPECT_EQ("test_topic", c.GetTopic());
+    EXPECT_EQ("raw16", c.GetParam("format", ""));
+  }
+  {
+    lptc_coderdojo::Command c = lptc_coderdojo::Command::FromMessagePayload(
+        "SUBSCRIBE depth format=raw16 fps=10 scale=2");
+    EXPECT_EQ(lptc_coderdojo::Command::Action::SUBSCRIBE, c.GetAction());
+    EXPECT_EQ("depth", c.GetTopic());
+    EXPECT_EQ(3u, c.GetParams().size());
+    EXPECT_EQ("raw16", c.GetParam("format", ""));
+    EXPECT_EQ("10", c.GetParam("fps", ""));
+    EXPECT_EQ("2", c.GetParam("scale", ""));
+    EXPECT_EQ("none", c.GetParam("roi", "none"));
+  }
 }
 
 }  // namespace
\ No newline at end of file
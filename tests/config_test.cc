@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include "config.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+bool Parse(std::vector<const char*> args,
+           lptc_coderdojo::ServerConfig* config) {
+  std::string error;
+  args.insert(args.begin(), "run_server");
+  return lptc_coderdojo::ParseCommandLine(args.size(), args.data(), config,
+                                          &error);
+}
+
+bool ParseLoad(std::vector<const char*> args,
+               lptc_coderdojo::LoadConfig* config) {
+  std::string error;
+  args.insert(args.begin(), "run_loadgen");
+  return lptc_coderdojo::ParseLoadCommandLine(args.size(), args.data(),
+                                              config, &error);
+}
+
+TEST(ConfigTest, ParseCommandLine_Defaults) {
+  lptc_coderdojo::ServerConfig config;
+  ASSERT_TRUE(Parse({}, &config));
+  EXPECT_EQ(9002, config.port);
+  EXPECT_TRUE(config.device_indices.empty());
+  EXPECT_EQ(lptc_coderdojo::DeviceSource::KINECT, config.source);
+  EXPECT_TRUE(config.record_path.empty());
+  EXPECT_EQ(lptc_coderdojo::ReplayMode::REALTIME, config.replay.mode);
+  EXPECT_EQ(0, config.replay.loops);
+  EXPECT_EQ(lptc_coderdojo::Encoding::RAW16, config.record_depth_encoding);
+  EXPECT_EQ(lptc_coderdojo::Encoding::RGB, config.record_video_encoding);
+  EXPECT_EQ(lptc_coderdojo::Resolution::MEDIUM,
+            config.device.video_resolution);
+  EXPECT_EQ(lptc_coderdojo::VideoFormat::RGB, config.device.video_format);
+  EXPECT_EQ(lptc_coderdojo::DepthFormat::RAW11, config.device.depth_format);
+  EXPECT_EQ(0, config.device.max_fps);
+  EXPECT_EQ(std::chrono::milliseconds(10), config.device.sync_tolerance);
+  EXPECT_FALSE(config.show_help);
+}
+
+TEST(ConfigTest, ParseCommandLine_Valid) {
+  lptc_coderdojo::ServerConfig config;
+  ASSERT_TRUE(Parse({"--port=9100", "--devices=2,0,2",
+                     "--video-resolution=high", "--video-format=ir",
+                     "--depth-format=mm", "--max-fps=15", "--io-threads=2",
+                     "--transform-threads=3", "--sync-tolerance-ms=5",
+                     "--source=synthetic", "--record=/tmp/kinect.cap",
+                     "--record-depth=rvl", "--record-video=jpeg"},
+                    &config));
+  EXPECT_EQ(9100, config.port);
+  EXPECT_EQ(std::vector<int>({0, 2}), config.device_indices);
+  EXPECT_EQ(lptc_coderdojo::Resolution::HIGH, config.device.video_resolution);
+  EXPECT_EQ(lptc_coderdojo::VideoFormat::IR, config.device.video_format);
+  EXPECT_EQ(lptc_coderdojo::DepthFormat::MM, config.device.depth_format);
+  EXPECT_EQ(15, config.device.max_fps);
+  EXPECT_EQ(2u, config.io_threads);
+  EXPECT_EQ(3u, config.transform_threads);
+  EXPECT_EQ(std::chrono::milliseconds(5), config.device.sync_tolerance);
+  EXPECT_EQ(lptc_coderdojo::DeviceSource::SYNTHETIC, config.source);
+  EXPECT_EQ("/tmp/kinect.cap", config.record_path);
+  EXPECT_EQ(lptc_coderdojo::Encoding::RVL, config.record_depth_encoding);
+  EXPECT_EQ(lptc_coderdojo::Encoding::JPEG, config.record_video_encoding);
+
+  ASSERT_TRUE(Parse({"--source=replay", "--replay=/tmp/kinect.cap",
+                     "--replay-mode=max", "--replay-loops=3"},
+                    &config));
+  EXPECT_EQ(lptc_coderdojo::DeviceSource::REPLAY, config.source);
+  EXPECT_EQ("/tmp/kinect.cap", config.replay.path);
+  EXPECT_EQ(lptc_coderdojo::ReplayMode::MAX_SPEED, config.replay.mode);
+  EXPECT_EQ(3, config.replay.loops);
+
+  ASSERT_TRUE(Parse({"--help"}, &config));
+  EXPECT_TRUE(config.show_help);
+
+  ASSERT_TRUE(Parse({"--devices=all"}, &config));
+  EXPECT_TRUE(config.device_indices.empty());
+}
+
+TEST(ConfigTest, ParseCommandLine_Invalid) {
+  lptc_coderdojo::ServerConfig config;
+  EXPECT_FALSE(Parse({"port=9100"}, &config));
+  EXPECT_FALSE(Parse({"--port"}, &config));
+  EXPECT_FALSE(Parse({"--port=0"}, &config));
+  EXPECT_FALSE(Parse({"--port=70000"}, &config));
+  EXPECT_FALSE(Parse({"--video-format=yuv"}, &config));
+  EXPECT_FALSE(Parse({"--depth-format=10bit"}, &config));
+  EXPECT_FALSE(Parse({"--video-resolution=low"}, &config));
+  EXPECT_FALSE(Parse({"--source=fakenect"}, &config));
+  EXPECT_FALSE(Parse({"--record="}, &config));
+  EXPECT_FALSE(Parse({"--record-depth=png"}, &config));
+  EXPECT_FALSE(Parse({"--replay-mode=fast"}, &config));
+  EXPECT_FALSE(Parse({"--replay-loops=-1"}, &config));
+  EXPECT_FALSE(Parse({"--max-fps=31"}, &config));
+  EXPECT_FALSE(Parse({"--sync-tolerance-ms=101"}, &config));
+  EXPECT_FALSE(Parse({"--devices="}, &config));
+  EXPECT_FALSE(Parse({"--devices=0,"}, &config));
+  EXPECT_FALSE(Parse({"--devices=0,x"}, &config));
+  EXPECT_FALSE(Parse({"--colour=red"}, &config));
+  EXPECT_FALSE(Parse({"--config=/nonexistent/kinect.conf"}, &config));
+}
+
+TEST(ConfigTest, ParseCommandLine_ConfigFile) {
+  std::string path = testing::TempDir() + "config_test.conf";
+  {
+    std::ofstream file(path);
+    file << "# Low bandwidth deployment\n"
+         << "\n"
+         << "  port=9200\n"
+         << "video-format=bayer\r\n"
+         << "depth-format=registered\n";
+  }
+
+  lptc_coderdojo::ServerConfig config;
+  std::string config_arg = "--config=" + path;
+  // Flags after the file override it.
+  ASSERT_TRUE(Parse({config_arg.c_str(), "--port=9300"}, &config));
+  EXPECT_EQ(9300, config.port);
+  EXPECT_EQ(lptc_coderdojo::VideoFormat::BAYER, config.device.video_format);
+  EXPECT_EQ(lptc_coderdojo::DepthFormat::REGISTERED,
+            config.device.depth_format);
+
+  {
+    std::ofstream file(path);
+    file << "port=9200\n"
+         << "help\n";
+  }
+  std::string error;
+  const char* args[] = {"run_server", config_arg.c_str()};
+  EXPECT_FALSE(lptc_coderdojo::ParseCommandLine(2, args, &config, &error));
+  EXPECT_NE(std::string::npos, error.find(":2:")) << error;
+  std::remove(path.c_str());
+}
+
+TEST(ConfigTest, ParseLoadCommandLine) {
+  lptc_coderdojo::LoadConfig config;
+  EXPECT_EQ("localhost", config.host);
+  EXPECT_EQ(9002, config.port);
+  EXPECT_EQ(std::vector<std::string>({"video", "depth"}), config.topics);
+
+  ASSERT_TRUE(ParseLoad({"--host=10.0.0.2", "--port=9100", "--clients=50",
+                         "--topics=kinect1/rgbd,depth",
+                         "--params=format=jpeg fps=15", "--warmup-s=0",
+                         "--duration-s=60", "--io-threads=4"},
+                        &config));
+  EXPECT_EQ("10.0.0.2", config.host);
+  EXPECT_EQ(9100, config.port);
+  EXPECT_EQ(50, config.clients);
+  EXPECT_EQ(std::vector<std::string>({"kinect1/rgbd", "depth"}),
+            config.topics);
+  EXPECT_EQ("format=jpeg fps=15", config.params);
+  EXPECT_EQ(std::chrono::seconds(0), config.warmup);
+  EXPECT_EQ(std::chrono::seconds(60), config.duration);
+  EXPECT_EQ(4u, config.io_threads);
+
+  EXPECT_FALSE(ParseLoad({"--clients=0"}, &config));
+  EXPECT_FALSE(ParseLoad({"--duration-s=0"}, &config));
+  EXPECT_FALSE(ParseLoad({"--topics=video,"}, &config));
+  EXPECT_FALSE(ParseLoad({"--topics=video,,depth"}, &config));
+  EXPECT_FALSE(ParseLoad({"--host="}, &config));
+  EXPECT_FALSE(ParseLoad({"--config=loadgen.conf"}, &config));
+}
+
+}  // namespace
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "frame.h"
+#include "frame_queue.h"
+
+#include <thread>
+
+namespace {
+
+typedef lptc_coderdojo::FramePool<int> IntFramePool;
+typedef lptc_coderdojo::FrameQueue<int> IntFrameQueue;
+
+const std::chrono::milliseconds kTimeout = std::chrono::milliseconds(10);
+
+IntFrameQueue::FramePtr MakeFrame(int value) {
+  IntFrameQueue::FramePtr frame =
+      std::make_shared<lptc_coderdojo::Frame<int>>();
+  frame->data.push_back(value);
+  frame->timestamp = value;
+  return frame;
+}
+
+TEST(FrameQueueTest, PushPop_PreservesOrder) {
+  IntFrameQueue queue(3);
+  queue.Push(MakeFrame(1));
+  queue.Push(MakeFrame(2));
+  EXPECT_EQ(2u, queue.GetSize());
+
+  IntFrameQueue::FramePtr out;
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(1, out->data[0]);
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(2, out->data[0]);
+  EXPECT_EQ(0u, queue.GetSize());
+  EXPECT_EQ(0u, queue.GetDroppedFrames());
+}
+
+TEST(FrameQueueTest, Push_DropOldestWhenFull) {
+  IntFrameQueue queue(2, lptc_coderdojo::OverflowPolicy::DROP_OLDEST);
+  for (int i = 0; i < 5; i++) queue.Push(MakeFrame(i));
+  EXPECT_EQ(2u, queue.GetSize());
+  EXPECT_EQ(3u, queue.GetDroppedFrames());
+
+  IntFrameQueue::FramePtr out;
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(3, out->data[0]);
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(4, out->data[0]);
+}
+
+TEST(FrameQueueTest, Push_DropNewestWhenFull) {
+  IntFrameQueue queue(2, lptc_coderdojo::OverflowPolicy::DROP_NEWEST);
+  for (int i = 0; i < 5; i++) queue.Push(MakeFrame(i));
+  EXPECT_EQ(2u, queue.GetSize());
+  EXPECT_EQ(3u, queue.GetDroppedFrames());
+
+  IntFrameQueue::FramePtr out;
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(0, out->data[0]);
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(1, out->data[0]);
+}
+
+TEST(FrameQueueTest, Push_BlockWhenFull) {
+  IntFrameQueue queue(1, lptc_coderdojo::OverflowPolicy::BLOCK);
+  queue.Push(MakeFrame(1));
+
+  IntFrameQueue::FramePtr second = MakeFrame(2);
+  std::thread producer([&queue, &second] { queue.Push(second); });
+
+  IntFrameQueue::FramePtr out;
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(1, out->data[0]);
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(2, out->data[0]);
+  producer.join();
+  EXPECT_EQ(0u, queue.GetDroppedFrames());
+}
+
+TEST(FrameQueueTest, Close_WakesWaitingPopAfterDraining) {
+  IntFrameQueue queue(2);
+  queue.Push(MakeFrame(1));
+
+  IntFrameQueue::FramePtr out;
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_EQ(1, out->data[0]);
+
+  std::thread closer([&queue] {
+    std::this_thread::sleep_for(kTimeout);
+    queue.Close();
+  });
+  EXPECT_FALSE(queue.Pop(out));
+  closer.join();
+
+  queue.Push(MakeFrame(2));
+  EXPECT_EQ(0u, queue.GetSize());
+  EXPECT_FALSE(queue.Pop(out));
+}
+
+TEST(FrameQueueTest, Clear_ReleasesFramesWithoutCountingDrops) {
+  IntFrameQueue queue(2);
+  IntFrameQueue::FramePtr frame = MakeFrame(1);
+  queue.Push(frame);
+  EXPECT_EQ(2, frame.use_count());
+
+  queue.Clear();
+  EXPECT_EQ(1, frame.use_count());
+  EXPECT_EQ(0u, queue.GetSize());
+  EXPECT_EQ(0u, queue.GetDroppedFrames());
+  EXPECT_EQ(2u, queue.GetCapacity());
+}
+
+TEST(FramePoolTest, Acquire_ReusesReleasedFrames) {
+  IntFramePool pool(2, 4);
+  IntFramePool::FramePtr a = pool.Acquire();
+  IntFramePool::FramePtr b = pool.Acquire();
+  ASSERT_TRUE(a && b);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(4u, a->data.size());
+
+  EXPECT_FALSE(pool.Acquire());
+  EXPECT_EQ(1u, pool.GetMisses());
+
+  const lptc_coderdojo::Frame<int>* released = a.get();
+  a.reset();
+  IntFramePool::FramePtr c = pool.Acquire();
+  EXPECT_EQ(released, c.get());
+}
+
+TEST(FramePoolTest, Acquire_FramesHeldByQueueAreNotReused) {
+  IntFramePool pool(2, 1);
+  IntFrameQueue queue(2);
+  queue.Push(pool.Acquire());
+  queue.Push(pool.Acquire());
+  EXPECT_FALSE(pool.Acquire());
+
+  IntFrameQueue::FramePtr out;
+  ASSERT_TRUE(queue.Pop(out));
+  EXPECT_FALSE(pool.Acquire());
+  out.reset();
+  EXPECT_TRUE(pool.Acquire());
+
+  pool.Grow(3);
+  EXPECT_EQ(3u, pool.GetSize());
+}
+
+}  // namespace
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "frame_synchronizer.h"
+
+#include <thread>
+
+namespace {
+
+const std::chrono::system_clock::time_point kStart =
+    std::chrono::system_clock::time_point() + std::chrono::hours(24);
+const std::chrono::microseconds kTolerance = std::chrono::milliseconds(10);
+
+lptc_coderdojo::DepthFramePtr MakeDepth(int ms) {
+  lptc_coderdojo::DepthFramePtr frame =
+      std::make_shared<lptc_coderdojo::Frame<uint16_t>>();
+  frame->timestamp = ms;
+  frame->capture_time = kStart + std::chrono::milliseconds(ms);
+  return frame;
+}
+
+lptc_coderdojo::VideoFramePtr MakeVideo(int ms) {
+  lptc_coderdojo::VideoFramePtr frame =
+      std::make_shared<lptc_coderdojo::Frame<uint8_t>>();
+  frame->timestamp = ms;
+  frame->capture_time = kStart + std::chrono::milliseconds(ms);
+  return frame;
+}
+
+TEST(FrameSynchronizerTest, PairsFramesWithinTolerance) {
+  lptc_coderdojo::FrameSynchronizer sync(kTolerance);
+  sync.AddDepth(MakeDepth(0));
+  sync.AddVideo(MakeVideo(4));
+  sync.AddVideo(MakeVideo(33));
+  sync.AddDepth(MakeDepth(29));
+
+  lptc_coderdojo::RgbdFrame pair;
+  ASSERT_TRUE(sync.Pop(pair));
+  EXPECT_EQ(0u, pair.depth->timestamp);
+  EXPECT_EQ(4u, pair.video->timestamp);
+  ASSERT_TRUE(sync.Pop(pair));
+  EXPECT_EQ(29u, pair.depth->timestamp);
+  EXPECT_EQ(33u, pair.video->timestamp);
+  EXPECT_EQ(0u, sync.GetUnmatchedFrames());
+}
+
+TEST(FrameSynchronizerTest, SkipsFramesWithoutPartner) {
+  lptc_coderdojo::FrameSynchronizer sync(kTolerance);
+  // Video stalls: the first depth frames age out of the backlog.
+  sync.AddDepth(MakeDepth(0));
+  sync.AddDepth(MakeDepth(33));
+  sync.AddDepth(MakeDepth(66));
+  // Closest to 66, so 33 is passed over.
+  sync.AddVideo(MakeVideo(70));
+
+  lptc_coderdojo::RgbdFrame pair;
+  ASSERT_TRUE(sync.Pop(pair));
+  EXPECT_EQ(66u, pair.depth->timestamp);
+  EXPECT_EQ(70u, pair.video->timestamp);
+  EXPECT_EQ(2u, sync.GetUnmatchedFrames());
+
+  // Too far from anything pending.
+  sync.AddVideo(MakeVideo(90));
+  sync.AddDepth(MakeDepth(110));
+  sync.Close();
+  EXPECT_FALSE(sync.Pop(pair));
+}
+
+TEST(FrameSynchronizerTest, DropsOldestPairWhenConsumerIsBehind) {
+  lptc_coderdojo::FrameSynchronizer sync(kTolerance);
+  for (int i = 0; i < 3; i++) {
+    sync.AddDepth(MakeDepth(i * 33));
+    sync.AddVideo(MakeVideo(i * 33 + 1));
+  }
+  EXPECT_EQ(1u, sync.GetDroppedPairs());
+
+  lptc_coderdojo::RgbdFrame pair;
+  ASSERT_TRUE(sync.Pop(pair));
+  EXPECT_EQ(33u, pair.depth->timestamp);
+}
+
+TEST(FrameSynchronizerTest, CloseWakesWaitingPop) {
+  lptc_coderdojo::FrameSynchronizer sync(kTolerance);
+  std::thread closer([&sync] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    sync.Close();
+  });
+
+  lptc_coderdojo::RgbdFrame pair;
+  EXPECT_FALSE(sync.Pop(pair));
+  closer.join();
+
+  // Frames added after closing are dropped.
+  sync.AddDepth(MakeDepth(0));
+  sync.AddVideo(MakeVideo(0));
+  EXPECT_FALSE(sync.Pop(pair));
+}
+
+TEST(FrameSynchronizerTest, ClearReleasesFrames) {
+  lptc_coderdojo::FrameSynchronizer sync(kTolerance);
+  lptc_coderdojo::DepthFramePtr depth = MakeDepth(0);
+  sync.AddDepth(depth);
+  EXPECT_EQ(2, depth.use_count());
+
+  sync.Clear();
+  EXPECT_EQ(1, depth.use_count());
+  EXPECT_EQ(0u, sync.GetUnmatchedFrames());
+}
+
+}  // namespace
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "latency_stats.h"
+
+namespace {
+
+TEST(LatencyStatsTest, NearestRankPercentiles) {
+  lptc_coderdojo::LatencyStats stats;
+  EXPECT_EQ(0, stats.GetPercentile(50));
+
+  // Added out of order: 1 to 1000.
+  for (int64_t i = 1000; i >= 1; i--) stats.Add(i);
+  EXPECT_EQ(1000u, stats.GetCount());
+  EXPECT_EQ(1, stats.GetPercentile(0));
+  EXPECT_EQ(500, stats.GetPercentile(50));
+  EXPECT_EQ(990, stats.GetPercentile(99));
+  EXPECT_EQ(999, stats.GetPercentile(99.9));
+  EXPECT_EQ(1000, stats.GetPercentile(100));
+}
+
+TEST(LatencyStatsTest, MergeAndClear) {
+  lptc_coderdojo::LatencyStats first;
+  lptc_coderdojo::LatencyStats second;
+  first.Add(30);
+  first.Add(10);
+  EXPECT_EQ(30, first.GetPercentile(100));
+  second.Add(20);
+  second.Add(40);
+
+  first.Merge(second);
+  EXPECT_EQ(4u, first.GetCount());
+  EXPECT_EQ(20, first.GetPercentile(50));
+  EXPECT_EQ(40, first.GetPercentile(100));
+
+  first.Clear();
+  EXPECT_EQ(0u, first.GetCount());
+  EXPECT_EQ(0, first.GetPercentile(99));
+}
+
+}  // namespace
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include "metrics.h"
+
+namespace {
+
+TEST(LatencyHistogramTest, BucketsByUpperBound) {
+  lptc_coderdojo::LatencyHistogram histogram;
+  histogram.Record(std::chrono::microseconds(25));
+  histogram.Record(std::chrono::microseconds(26));
+  histogram.Record(std::chrono::nanoseconds(-5));
+  histogram.Record(std::chrono::seconds(2));
+
+  EXPECT_EQ(4u, histogram.GetCount());
+  EXPECT_EQ(2u, histogram.GetBucketCount(0));
+  EXPECT_EQ(1u, histogram.GetBucketCount(1));
+  EXPECT_EQ(1u, histogram.GetBucketCount(lptc_coderdojo::kLatencyBounds));
+  EXPECT_EQ(std::chrono::microseconds(2000051), histogram.GetSum());
+}
+
+TEST(PipelineMetricsTest, FormatPrometheusMetrics) {
+  lptc_coderdojo::PipelineMetrics pipeline;
+  pipeline.RecordStage(lptc_coderdojo::PipelineStage::TRANSFORM,
+                       std::chrono::microseconds(300));
+  pipeline.RecordStage(lptc_coderdojo::PipelineStage::TRANSFORM,
+                       std::chrono::milliseconds(3));
+  pipeline.AddSentFrame(100);
+  pipeline.AddSentFrame(50);
+  pipeline.AddDroppedFrame();
+  pipeline.AddSendError();
+
+  lptc_coderdojo::ChannelReport report = {"kinect0/depth", 2, 1, 4,
+                                          &pipeline};
+  std::string text = lptc_coderdojo::FormatPrometheusMetrics({report});
+
+  EXPECT_NE(std::string::npos,
+            text.find("# TYPE kinect_stage_latency_seconds histogram\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_stage_latency_seconds_bucket{channel=\"kinect0/"
+                      "depth\",stage=\"transform\",le=\"0.00025\"} 0\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_stage_latency_seconds_bucket{channel=\"kinect0/"
+                      "depth\",stage=\"transform\",le=\"0.0005\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_stage_latency_seconds_bucket{channel=\"kinect0/"
+                      "depth\",stage=\"transform\",le=\"+Inf\"} 2\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_stage_latency_seconds_count{channel=\"kinect0/"
+                      "depth\",stage=\"serialize\"} 0\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_channel_subscribers{channel=\"kinect0/depth\"} "
+                      "2\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_channel_queued_frames{channel=\"kinect0/"
+                      "depth\"} 1\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_channel_dropped_frames_total{channel=\"kinect0/"
+                      "depth\"} 5\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_channel_sent_bytes_total{channel=\"kinect0/"
+                      "depth\"} 150\n"));
+  EXPECT_NE(std::string::npos,
+            text.find("kinect_channel_send_errors_total{channel=\"kinect0/"
+                      "depth\"} 1\n"));
+}
+
+}  // namespace
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include "recorder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+lptc_coderdojo::CaptureRecord MakeRecord(uint32_t device_timestamp) {
+  lptc_coderdojo::CaptureRecord record;
+  std::memset(&record, 0, sizeof(record));
+  record.data_type = 2;
+  record.device = 1;
+  record.width = 4;
+  record.height = 3;
+  record.device_timestamp = device_timestamp;
+  record.capture_time_us = 1000 * device_timestamp;
+  return record;
+}
+
+TEST(RecorderTest, WritesHeaderIndexAndRecords) {
+  std::string path = testing::TempDir() + "recorder_test.cap";
+  std::vector<uint8_t> payload(1500);
+  {
+    // Two records per page-sized segment.
+    lptc_coderdojo::FrameRecorder recorder(path, 4096);
+    for (uint32_t i = 0; i < 5; i++) {
+      payload.assign(payload.size(), static_cast<uint8_t>(i));
+      ASSERT_TRUE(recorder.Record(MakeRecord(i), payload.data(),
+                                  payload.size() - i));
+    }
+    recorder.Close();
+    EXPECT_EQ(5u, recorder.GetRecordedFrames());
+    EXPECT_EQ(0u, recorder.GetDroppedFrames());
+    EXPECT_FALSE(recorder.Record(MakeRecord(5), payload.data(), 1));
+  }
+
+  std::vector<uint8_t> file = ReadFile(path);
+  ASSERT_GE(file.size(), sizeof(lptc_coderdojo::CaptureHeader));
+  lptc_coderdojo::CaptureHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  EXPECT_EQ(lptc_coderdojo::kCaptureMagic, header.magic);
+  EXPECT_EQ(lptc_coderdojo::kCaptureVersion, header.version);
+  ASSERT_EQ(5u, header.frame_count);
+  ASSERT_EQ(file.size(), header.index_offset + 5 * sizeof(uint64_t));
+
+  std::vector<uint64_t> index(5);
+  std::memcpy(index.data(), &file[header.index_offset],
+              index.size() * sizeof(uint64_t));
+  EXPECT_EQ(header.data_offset, index[0]);
+  EXPECT_EQ(header.data_offset + 2 * header.segment_size, index[4]);
+  for (uint32_t i = 0; i < 5; i++) {
+    lptc_coderdojo::CaptureRecord record;
+    std::memcpy(&record, &file[index[i]], sizeof(record));
+    EXPECT_EQ(lptc_coderdojo::kCaptureRecordMagic, record.magic);
+    EXPECT_EQ(i, record.device_timestamp);
+    EXPECT_EQ(1, record.device);
+    EXPECT_EQ(1000 * i, record.capture_time_us);
+    ASSERT_EQ(1500 - i, record.payload_size);
+    EXPECT_EQ(i, file[index[i] + sizeof(record) + record.payload_size - 1]);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(RecorderTest, DropsFramesThatDoNotFit) {
+  std::string path = testing::TempDir() + "recorder_test.cap";
+  std::vector<uint8_t> payload(8192);
+  lptc_coderdojo::FrameRecorder recorder(path, 4096, 2048);
+
+  EXPECT_FALSE(recorder.Record(MakeRecord(0), payload.data(), 3000));
+  EXPECT_FALSE(recorder.Record(MakeRecord(1), payload.data(), 8192));
+  EXPECT_TRUE(recorder.Record(MakeRecord(2), payload.data(), 100));
+  recorder.Close();
+  EXPECT_EQ(1u, recorder.GetRecordedFrames());
+  EXPECT_EQ(2u, recorder.GetDroppedFrames());
+  std::remove(path.c_str());
+}
+
+TEST(RecorderTest, WrapsBufferWithoutCorruption) {
+  std::string path = testing::TempDir() + "recorder_test.cap";
+  const uint32_t kFrames = 500;
+  {
+    // Odd sizes leave gaps of every length at the end of the buffer.
+    lptc_coderdojo::FrameRecorder recorder(path, 65536, 8192);
+    for (uint32_t i = 0; i < kFrames; i++) {
+      std::vector<uint8_t> payload(700 + i % 97, static_cast<uint8_t>(i));
+      recorder.Record(MakeRecord(i), payload.data(), payload.size());
+    }
+    recorder.Close();
+    EXPECT_EQ(kFrames,
+              recorder.GetRecordedFrames() + recorder.GetDroppedFrames());
+  }
+
+  std::vector<uint8_t> file = ReadFile(path);
+  lptc_coderdojo::CaptureHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  ASSERT_GT(header.frame_count, 0u);
+  uint32_t last = 0;
+  for (uint64_t i = 0; i < header.frame_count; i++) {
+    uint64_t offset;
+    std::memcpy(&offset, &file[header.index_offset + i * sizeof(offset)],
+                sizeof(offset));
+    lptc_coderdojo::CaptureRecord record;
+    std::memcpy(&record, &file[offset], sizeof(record));
+    ASSERT_EQ(lptc_coderdojo::kCaptureRecordMagic, record.magic);
+    if (i > 0) {
+      EXPECT_GT(record.device_timestamp, last);
+    }
+    last = record.device_timestamp;
+    ASSERT_EQ(700 + last % 97, record.payload_size);
+    for (uint32_t j = 0; j < record.payload_size; j++) {
+      ASSERT_EQ(static_cast<uint8_t>(last), file[offset + sizeof(record) + j]);
+    }
+  }
+  std::remove(path.c_str());
+}
+
+TEST(RecorderTest, WrapsRecordsEndingAtBufferEnd) {
+  std::string path = testing::TempDir() + "recorder_test.cap";
+  const uint32_t kFrames = 200;
+  // Whole records fill the buffer exactly, so the last one ends at the very
+  // end and the next starts over at the front with nothing wasted. Each
+  // record takes a segment of its own, which slows the writer down.
+  const size_t kRecordSize = 4096;
+  std::vector<uint8_t> payload(
+      kRecordSize - sizeof(lptc_coderdojo::CaptureRecord));
+  ASSERT_EQ(kRecordSize, lptc_coderdojo::GetCaptureRecordSize(payload.size()));
+  {
+    lptc_coderdojo::FrameRecorder recorder(path, kRecordSize, 4 * kRecordSize);
+    for (uint32_t i = 0; i < kFrames; i++) {
+      payload.assign(payload.size(), static_cast<uint8_t>(i));
+      // Retry until the writer makes room, so records keep wrapping while
+      // earlier ones are still buffered.
+      while (!recorder.Record(MakeRecord(i), payload.data(), payload.size())) {
+        std::this_thread::yield();
+      }
+    }
+    recorder.Close();
+    EXPECT_EQ(kFrames, recorder.GetRecordedFrames());
+  }
+
+  std::vector<uint8_t> file = ReadFile(path);
+  lptc_coderdojo::CaptureHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  ASSERT_EQ(kFrames, header.frame_count);
+  for (uint32_t i = 0; i < kFrames; i++) {
+    uint64_t offset;
+    std::memcpy(&offset, &file[header.index_offset + i * sizeof(offset)],
+                sizeof(offset));
+    lptc_coderdojo::CaptureRecord record;
+    std::memcpy(&record, &file[offset], sizeof(record));
+    ASSERT_EQ(lptc_coderdojo::kCaptureRecordMagic, record.magic);
+    EXPECT_EQ(i, record.device_timestamp);
+    ASSERT_EQ(payload.size(), record.payload_size);
+    EXPECT_EQ(static_cast<uint8_t>(i), file[offset + sizeof(record)]);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(RecorderTest, ThrowsForUnwritablePath) {
+  EXPECT_THROW(lptc_coderdojo::FrameRecorder("/nonexistent/dir/x.cap"),
+               std::runtime_error);
+}
+
+}  // namespace
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include "../protocol/protocol_generated.h"
+#include "recorder.h"
+#include "replay_device.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+typedef lptc_coderdojo::protocol::DataType DataType;
+
+const int kWidth = 4;
+const int kHeight = 3;
+const int kFrames = 3;
+const int64_t kFrameIntervalUs = 30000;
+
+lptc_coderdojo::CaptureRecord MakeRecord(DataType type, int device,
+                                         uint32_t frame) {
+  lptc_coderdojo::CaptureRecord record = {};
+  record.data_type = static_cast<uint8_t>(type);
+  record.device = static_cast<uint8_t>(device);
+  record.format = static_cast<uint8_t>(lptc_coderdojo::DepthFormat::MM);
+  record.width = kWidth;
+  record.height = kHeight;
+  record.device_timestamp = 100 + frame;
+  record.capture_time_us = 5000000 + frame * kFrameIntervalUs;
+  return record;
+}
+
+// Device 0 has kFrames interleaved depth and video frames, whose samples
+// all equal the frame number. Device 1 has a single depth frame.
+std::string WriteCapture() {
+  std::string path = testing::TempDir() + "replay_device_test.cap";
+  lptc_coderdojo::FrameRecorder recorder(path, 4096);
+  for (uint32_t i = 0; i < kFrames; i++) {
+    std::vector<uint16_t> depth(kWidth * kHeight, static_cast<uint16_t>(i));
+    std::vector<uint8_t> video(kWidth * kHeight * 3, static_cast<uint8_t>(i));
+    recorder.Record(MakeRecord(DataType::DepthRaw16, 0, i), depth.data(),
+                    depth.size() * sizeof(uint16_t));
+    recorder.Record(MakeRecord(DataType::VideoRgb, 0, i), video.data(),
+                    video.size());
+  }
+  std::vector<uint16_t> depth(kWidth * kHeight);
+  recorder.Record(MakeRecord(DataType::DepthRaw16, 1, 0), depth.data(),
+                  depth.size() * sizeof(uint16_t));
+  recorder.Close();
+  return path;
+}
+
+lptc_coderdojo::ReplayConfig MakeReplayConfig(lptc_coderdojo::ReplayMode mode) {
+  lptc_coderdojo::ReplayConfig replay;
+  replay.mode = mode;
+  replay.loops = 1;
+  return replay;
+}
+
+TEST(ReplayDeviceTest, CaptureReader_ReadsIndexAndWalksUnclosedFiles) {
+  std::string path = WriteCapture();
+  {
+    lptc_coderdojo::CaptureReader capture(path);
+    ASSERT_EQ(2u * kFrames + 1, capture.GetRecords().size());
+    EXPECT_EQ(std::vector<int>({0, 1}), capture.GetDevices());
+    const lptc_coderdojo::CaptureRecord* last = capture.GetRecords().back();
+    EXPECT_EQ(1, last->device);
+    EXPECT_EQ(kWidth * kHeight * sizeof(uint16_t), last->payload_size);
+  }
+
+  // Clear the index offset, as if the recorder had never closed.
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t index_offset = 0;
+    file.seekp(offsetof(lptc_coderdojo::CaptureHeader, index_offset));
+    file.write(reinterpret_cast<const char*>(&index_offset),
+               sizeof(index_offset));
+  }
+  lptc_coderdojo::CaptureReader capture(path);
+  ASSERT_EQ(2u * kFrames + 1, capture.GetRecords().size());
+  for (int i = 0; i < kFrames; i++) {
+    EXPECT_EQ(100u + i, capture.GetRecords()[2 * i]->device_timestamp);
+    EXPECT_EQ(i, lptc_coderdojo::CaptureReader::GetPayload(
+                     capture.GetRecords()[2 * i + 1])[0]);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(ReplayDeviceTest, CaptureReader_ThrowsForOtherFiles) {
+  std::string path = testing::TempDir() + "replay_device_test.txt";
+  std::ofstream(path) << std::string(100, 'x');
+  EXPECT_THROW(lptc_coderdojo::CaptureReader capture(path),
+               std::runtime_error);
+  std::remove(path.c_str());
+  EXPECT_THROW(lptc_coderdojo::CaptureReader capture(path),
+               std::runtime_error);
+}
+
+TEST(ReplayDeviceTest, MaxSpeed_ReplaysEveryFrameInOrder) {
+  std::string path = WriteCapture();
+  std::shared_ptr<const lptc_coderdojo::CaptureReader> capture =
+      std::make_shared<lptc_coderdojo::CaptureReader>(path);
+  lptc_coderdojo::ReplayKinectDevice device(
+      capture, 0, MakeReplayConfig(lptc_coderdojo::ReplayMode::MAX_SPEED),
+      lptc_coderdojo::DeviceConfig());
+  EXPECT_EQ(kWidth, device.GetDepthFrameWidth());
+  EXPECT_EQ(kHeight, device.GetVideoFrameHeight());
+  EXPECT_EQ(lptc_coderdojo::DepthFormat::MM, device.GetDepthFormat());
+  EXPECT_EQ(lptc_coderdojo::VideoFormat::RGB, device.GetVideoFormat());
+
+  device.StartDepth();
+  std::chrono::system_clock::time_point first_capture;
+  for (int i = 0; i < kFrames; i++) {
+    lptc_coderdojo::DepthFramePtr depth;
+    ASSERT_TRUE(device.GetNextDepthFrame(depth));
+    EXPECT_EQ(100u + i, depth->timestamp);
+    EXPECT_EQ(std::vector<uint16_t>(kWidth * kHeight, i), depth->data);
+    // Capture times keep the recorded spacing however fast playback runs.
+    if (i == 0) first_capture = depth->capture_time;
+    EXPECT_EQ(std::chrono::microseconds(i * kFrameIntervalUs),
+              depth->capture_time - first_capture);
+  }
+  device.Shutdown();
+  EXPECT_EQ(static_cast<size_t>(kFrames), device.GetReplayedFrames());
+  std::remove(path.c_str());
+}
+
+TEST(ReplayDeviceTest, Realtime_KeepsRecordedPace) {
+  std::string path = WriteCapture();
+  lptc_coderdojo::ReplayKinectDevice device(
+      std::make_shared<lptc_coderdojo::CaptureReader>(path), 0,
+      MakeReplayConfig(lptc_coderdojo::ReplayMode::REALTIME),
+      lptc_coderdojo::DeviceConfig());
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  device.StartVideo();
+  for (int i = 0; i < kFrames; i++) {
+    lptc_coderdojo::VideoFramePtr video;
+    ASSERT_TRUE(device.GetNextVideoFrame(video));
+    EXPECT_EQ(std::vector<uint8_t>(kWidth * kHeight * 3, i), video->data);
+  }
+  // Playback starts with the first consumer.
+  EXPECT_GE(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count(),
+            (kFrames - 1) * kFrameIntervalUs);
+  std::remove(path.c_str());
+}
+
+TEST(ReplayDeviceTest, ThrowsWithoutBothStreams) {
+  std::string path = WriteCapture();
+  std::shared_ptr<const lptc_coderdojo::CaptureReader> capture =
+      std::make_shared<lptc_coderdojo::CaptureReader>(path);
+  lptc_coderdojo::ReplayConfig replay;
+  lptc_coderdojo::DeviceConfig config;
+  EXPECT_THROW(lptc_coderdojo::ReplayKinectDevice(capture, 1, replay, config),
+               std::runtime_error);
+  EXPECT_THROW(lptc_coderdojo::ReplayKinectDevice(capture, 2, replay, config),
+               std::runtime_error);
+  std::remove(path.c_str());
+}
+
+}  // namespace
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include "stream_variant.h"
+
+namespace {
+
+bool ParseVariant(const std::string& payload,
+                  lptc_coderdojo::StreamVariant* variant) {
+  lptc_coderdojo::Command c =
+      lptc_coderdojo::Command::FromMessagePayload("SUBSCRIBE depth " + payload);
+  std::string error;
+  return lptc_coderdojo::StreamVariant::FromParams(c.GetParams(), variant,
+                                                   &error);
+}
+
+TEST(StreamVariantTest, FromParams_Invalid) {
+  lptc_coderdojo::StreamVariant v;
+  EXPECT_FALSE(ParseVariant("format=jpeg2000", &v));
+  EXPECT_FALSE(ParseVariant("fps=0", &v));
+  EXPECT_FALSE(ParseVariant("scale=9", &v));
+  EXPECT_FALSE(ParseVariant("filter=lanczos", &v));
+  EXPECT_FALSE(ParseVariant("roi=1,2,3", &v));
+  EXPECT_FALSE(ParseVariant("roi=1,2,3,4,", &v));
+  EXPECT_FALSE(ParseVariant("roi=1,2,0,4", &v));
+  EXPECT_FALSE(ParseVariant("roi=1,-2,3,4", &v));
+  EXPECT_FALSE(ParseVariant("colour=red", &v));
+  EXPECT_FALSE(ParseVariant("format=jpeg quality=101", &v));
+  EXPECT_FALSE(ParseVariant("format=rgb quality=50", &v));
+}
+
+TEST(StreamVariantTest, FromParams_Valid) {
+  lptc_coderdojo::StreamVariant v;
+  ASSERT_TRUE(ParseVariant("format=raw16 scale=4 filter=box roi=8,16,320,240",
+                           &v));
+  EXPECT_EQ(lptc_coderdojo::Encoding::RAW16, v.encoding);
+  EXPECT_EQ(0, v.fps);
+  EXPECT_EQ(4, v.scale);
+  EXPECT_EQ(lptc_coderdojo::ScaleFilter::BOX, v.filter);
+  EXPECT_EQ(8, v.roi.x);
+  EXPECT_EQ(16, v.roi.y);
+  EXPECT_EQ(320, v.roi.width);
+  EXPECT_EQ(240, v.roi.height);
+  EXPECT_EQ("format=raw16 fps=0 scale=4 filter=box roi=8,16,320,240",
+            v.ToString());
+
+  lptc_coderdojo::StreamVariant full;
+  ASSERT_TRUE(ParseVariant("scale=4 filter=box", &full));
+  EXPECT_TRUE(full.roi.IsEmpty());
+  EXPECT_NE(v, full);
+  EXPECT_TRUE(full < v || v < full);
+
+  lptc_coderdojo::StreamVariant jpeg;
+  ASSERT_TRUE(ParseVariant("format=jpeg", &jpeg));
+  EXPECT_EQ(75, jpeg.quality);
+  ASSERT_TRUE(ParseVariant("format=jpeg quality=40", &jpeg));
+  EXPECT_EQ(40, jpeg.quality);
+  EXPECT_EQ("format=jpeg fps=0 scale=1 quality=40", jpeg.ToString());
+}
+
+}  // namespace
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "synthetic_device.h"
+
+#include <algorithm>
+
+namespace {
+
+const int kWidth = 640;
+const int kHeight = 480;
+
+TEST(SyntheticDeviceTest, RenderSyntheticDepth_Deterministic) {
+  std::vector<uint16_t> first(kWidth * kHeight);
+  std::vector<uint16_t> again(kWidth * kHeight);
+  std::vector<uint16_t> next(kWidth * kHeight);
+  lptc_coderdojo::RenderSyntheticDepth(0, 7, lptc_coderdojo::DepthFormat::RAW11,
+                                       kWidth, kHeight, first.data());
+  lptc_coderdojo::RenderSyntheticDepth(0, 7, lptc_coderdojo::DepthFormat::RAW11,
+                                       kWidth, kHeight, again.data());
+  lptc_coderdojo::RenderSyntheticDepth(0, 8, lptc_coderdojo::DepthFormat::RAW11,
+                                       kWidth, kHeight, next.data());
+  EXPECT_EQ(first, again);
+  EXPECT_NE(first, next);
+}
+
+TEST(SyntheticDeviceTest, RenderSyntheticDepth_Formats) {
+  std::vector<uint16_t> raw(kWidth * kHeight);
+  lptc_coderdojo::RenderSyntheticDepth(0, 0, lptc_coderdojo::DepthFormat::RAW11,
+                                       kWidth, kHeight, raw.data());
+  EXPECT_EQ(2047, *std::max_element(raw.begin(), raw.end()));
+  EXPECT_EQ(2047, raw[kWidth - 1]);
+  // Disparity falls with distance: the floor is nearer than the wall.
+  EXPECT_LT(*std::min_element(raw.end() - kWidth, raw.end()),
+            *std::min_element(raw.begin(), raw.begin() + kWidth));
+
+  std::vector<uint16_t> mm(kWidth * kHeight);
+  lptc_coderdojo::RenderSyntheticDepth(0, 0, lptc_coderdojo::DepthFormat::MM,
+                                       kWidth, kHeight, mm.data());
+  EXPECT_EQ(0, mm[kWidth - 1]);
+  // A few pixels per row have no reading, so look at the farthest one.
+  EXPECT_NEAR(4000, *std::max_element(mm.begin(), mm.begin() + kWidth), 50);
+  EXPECT_NEAR(800, *std::max_element(mm.end() - kWidth, mm.end()), 50);
+}
+
+TEST(SyntheticDeviceTest, RenderSyntheticVideo_Ir) {
+  std::vector<uint8_t> rgb(kWidth * kHeight * 3);
+  std::vector<uint8_t> ir(kWidth * kHeight);
+  lptc_coderdojo::RenderSyntheticVideo(0, 0, lptc_coderdojo::VideoFormat::RGB,
+                                       kWidth, kHeight, rgb.data());
+  lptc_coderdojo::RenderSyntheticVideo(0, 0, lptc_coderdojo::VideoFormat::IR,
+                                       kWidth, kHeight, ir.data());
+  size_t i = kHeight / 2 * kWidth + kWidth / 2;
+  EXPECT_EQ((rgb[i * 3] * 77 + rgb[i * 3 + 1] * 150 + rgb[i * 3 + 2] * 29) >> 8,
+            ir[i]);
+}
+
+TEST(SyntheticDeviceTest, StreamsFrames) {
+  lptc_coderdojo::DeviceConfig config;
+  config.video_format = lptc_coderdojo::VideoFormat::IR;
+  lptc_coderdojo::SyntheticKinectDevice device(1, config);
+  EXPECT_EQ(640, device.GetVideoFrameWidth());
+  EXPECT_EQ(488, device.GetVideoFrameHeight());
+
+  device.StartDepth();
+  lptc_coderdojo::DepthFramePtr depth;
+  ASSERT_TRUE(device.GetNextDepthFrame(depth));
+  ASSERT_EQ(static_cast<size_t>(device.GetDepthFrameRectSize()),
+            depth->data.size());
+  std::vector<uint16_t> expected(depth->data.size());
+  lptc_coderdojo::RenderSyntheticDepth(1, depth->timestamp,
+                                       lptc_coderdojo::DepthFormat::RAW11,
+                                       kWidth, kHeight, expected.data());
+  EXPECT_EQ(expected, depth->data);
+  device.StopDepth();
+
+  device.StartRgbd();
+  lptc_coderdojo::RgbdFrame pair;
+  ASSERT_TRUE(device.GetNextRgbdFrame(pair));
+  EXPECT_EQ(pair.depth->timestamp, pair.video->timestamp);
+  EXPECT_EQ(static_cast<size_t>(device.GetVideoFrameRectSize()),
+            pair.video->data.size());
+
+  device.Shutdown();
+  EXPECT_FALSE(device.GetNextRgbdFrame(pair));
+}
+
+}  // namespace
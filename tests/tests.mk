@@ -1,3 +1,27 @@
-TESTS=command_test sample_test
+TESTS=codec_test command_test config_test frame_queue_test \
+	frame_synchronizer_test latency_stats_test metrics_test recorder_test \
+	replay_device_test sample_test stream_variant_test synthetic_device_test \
+	transform_test worker_pool_test
+codec_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,codec_test.o codec.o)
 command_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,command_test.o command.o)
-sample_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,sample_test.o)
\ No newline at end of file
+config_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,config_test.o config.o \
+	encoding.o)
+frame_queue_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,frame_queue_test.o)
+frame_synchronizer_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/, \
+	frame_synchronizer_test.o frame_synchronizer.o)
+latency_stats_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,latency_stats_test.o \
+	latency_stats.o)
+metrics_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,metrics_test.o metrics.o)
+recorder_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,recorder_test.o recorder.o)
+replay_device_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/, \
+	replay_device_test.o replay_device.o capture_file.o recorder.o codec.o \
+	transform.o frame_synchronizer.o config.o encoding.o)
+sample_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,sample_test.o)
+stream_variant_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,stream_variant_test.o \
+	stream_variant.o command.o config.o encoding.o)
+synthetic_device_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/, \
+	synthetic_device_test.o synthetic_device.o frame_synchronizer.o config.o \
+	encoding.o)
+transform_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,transform_test.o transform.o)
+worker_pool_test_OBJS=$(addprefix $(BUILD_LIBS_DIR)/,worker_pool_test.o \
+	worker_pool.o)
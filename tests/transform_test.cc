@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include "transform.h"
+
+#include <random>
+
+namespace {
+
+// Sizes cover the full frame, a frame smaller than one vector and lengths
+// that leave a tail for every kernel's scalar remainder.
+const size_t kPixelCounts[] = {640 * 480, 1, 5, 17, 33, 1000 + 7};
+
+TEST(TransformTest, DepthToRgba_MatchesScalarOnRandomFrames) {
+  const std::vector<lptc_coderdojo::TransformKernels>& kernels =
+      lptc_coderdojo::GetSupportedTransformKernels();
+  ASSERT_FALSE(kernels.empty());
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> sample(0, 0xFFFF);
+
+  for (size_t pixels : kPixelCounts) {
+    std::vector<uint16_t> depth(pixels);
+    for (size_t i = 0; i < pixels; i++) depth[i] = sample(rng);
+
+    std::vector<uint8_t> expected(pixels * 4);
+    kernels[0].depth_to_rgba(depth.data(), expected.data(), pixels);
+    EXPECT_EQ(255 - (depth[0] & 0xFF), expected[0]);
+    EXPECT_EQ(255, expected[3]);
+
+    for (size_t k = 1; k < kernels.size(); k++) {
+      std::vector<uint8_t> actual(pixels * 4);
+      kernels[k].depth_to_rgba(depth.data(), actual.data(), pixels);
+      EXPECT_EQ(expected, actual) << kernels[k].isa << ", " << pixels;
+    }
+  }
+}
+
+TEST(TransformTest, RgbToRgba_MatchesScalarOnRandomFrames) {
+  const std::vector<lptc_coderdojo::TransformKernels>& kernels =
+      lptc_coderdojo::GetSupportedTransformKernels();
+  ASSERT_FALSE(kernels.empty());
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> sample(0, 0xFF);
+
+  for (size_t pixels : kPixelCounts) {
+    std::vector<uint8_t> rgb(pixels * 3);
+    for (size_t i = 0; i < rgb.size(); i++) rgb[i] = sample(rng);
+
+    std::vector<uint8_t> expected(pixels * 4);
+    kernels[0].rgb_to_rgba(rgb.data(), expected.data(), pixels);
+    EXPECT_EQ(rgb[2], expected[2]);
+    EXPECT_EQ(255, expected[3]);
+
+    for (size_t k = 1; k < kernels.size(); k++) {
+      std::vector<uint8_t> actual(pixels * 4);
+      kernels[k].rgb_to_rgba(rgb.data(), actual.data(), pixels);
+      EXPECT_EQ(expected, actual) << kernels[k].isa << ", " << pixels;
+    }
+  }
+}
+
+TEST(TransformTest, Dispatch_UsesBestKernel) {
+  std::vector<uint16_t> depth(64, 0x1234);
+  std::vector<uint8_t> rgba(depth.size() * 4);
+  lptc_coderdojo::TransformDepthToRgba(depth.data(), rgba.data(),
+                                       depth.size());
+  for (size_t i = 0; i < depth.size(); i++) {
+    EXPECT_EQ(255 - 0x34, rgba[i * 4]);
+    EXPECT_EQ(255, rgba[i * 4 + 3]);
+  }
+  EXPECT_EQ(&lptc_coderdojo::GetSupportedTransformKernels().back(),
+            &lptc_coderdojo::GetBestTransformKernels());
+}
+
+TEST(TransformTest, Packed11_RoundTripsLow11Bits) {
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> sample(0, 0xFFFF);
+
+  for (size_t pixels : kPixelCounts) {
+    std::vector<uint16_t> depth(pixels);
+    for (size_t i = 0; i < pixels; i++) depth[i] = sample(rng);
+
+    std::vector<uint8_t> packed(lptc_coderdojo::GetPacked11Size(pixels));
+    lptc_coderdojo::TransformDepthToPacked11(depth.data(), packed.data(),
+                                             pixels);
+    std::vector<uint16_t> unpacked(pixels);
+    lptc_coderdojo::TransformPacked11ToDepth(packed.data(), unpacked.data(),
+                                             pixels);
+    for (size_t i = 0; i < pixels; i++) {
+      ASSERT_EQ(depth[i] & 0x7FF, unpacked[i]) << pixels << ", " << i;
+    }
+  }
+}
+
+TEST(TransformTest, Packed11_IsMsbFirst) {
+  const uint16_t depth[] = {0x7FF, 0x000, 0x555};
+  uint8_t packed[5];
+  ASSERT_EQ(5u, lptc_coderdojo::GetPacked11Size(3));
+  lptc_coderdojo::TransformDepthToPacked11(depth, packed, 3);
+  // 11111111 111|00000 000000|10 10101010 1|0000000
+  EXPECT_EQ(0xFF, packed[0]);
+  EXPECT_EQ(0xE0, packed[1]);
+  EXPECT_EQ(0x02, packed[2]);
+  EXPECT_EQ(0xAA, packed[3]);
+  EXPECT_EQ(0x80, packed[4]);
+}
+
+// A 6x4 single-channel image whose samples are 10 * row + column.
+std::vector<uint16_t> MakeGradient() {
+  std::vector<uint16_t> image(6 * 4);
+  for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 6; x++) image[y * 6 + x] = 10 * y + x;
+  }
+  return image;
+}
+
+TEST(TransformTest, Decimate_CropsRegionWithStride) {
+  std::vector<uint16_t> image = MakeGradient();
+  std::vector<uint16_t> out(3 * 2);
+  // Region at (2, 1), 3x2, scale 1.
+  lptc_coderdojo::TransformDecimate(image.data() + 1 * 6 + 2, 3, 2, 6, 1, 1,
+                                    out.data());
+  EXPECT_EQ(std::vector<uint16_t>({12, 13, 14, 22, 23, 24}), out);
+
+  std::vector<uint16_t> half(3 * 2);
+  lptc_coderdojo::TransformDecimate(image.data(), 6, 4, 6, 1, 2, half.data());
+  EXPECT_EQ(std::vector<uint16_t>({0, 2, 4, 20, 22, 24}), half);
+}
+
+TEST(TransformTest, BoxDownscale_AveragesBlocks) {
+  std::vector<uint16_t> image = MakeGradient();
+  std::vector<uint16_t> out(3 * 2);
+  lptc_coderdojo::TransformBoxDownscale(image.data(), 6, 4, 6, 1, 2,
+                                        out.data());
+  // Each 2x2 block averages to 10 * y + x + 5.5, rounded up.
+  EXPECT_EQ(std::vector<uint16_t>({6, 8, 10, 26, 28, 30}), out);
+
+  // Channels are averaged separately and partial blocks are dropped.
+  const uint8_t rgb[] = {0, 100, 255, 2,  100, 255, 9, 9, 9,
+                         4, 100, 0,   10, 101, 0,   9, 9, 9};
+  uint8_t avg[3];
+  lptc_coderdojo::TransformBoxDownscale(rgb, 3, 2, 3, 3, 2, avg);
+  EXPECT_EQ(4, avg[0]);
+  EXPECT_EQ(100, avg[1]);
+  EXPECT_EQ(128, avg[2]);
+}
+
+TEST(TransformTest, DepthBoxDownscale_SkipsNoReadings) {
+  // 4x2 blocks: all valid, mixed, mixed and none valid.
+  const uint16_t depth[] = {100, 102, 2047, 400, 2047, 2047, 2047, 2047,
+                            104, 106, 2047, 402, 800,  2047, 2047, 2047};
+  uint16_t out[4];
+  lptc_coderdojo::TransformDepthBoxDownscale(depth, 8, 2, 8, 2, 2047, out);
+  EXPECT_EQ(103, out[0]);
+  EXPECT_EQ(401, out[1]);
+  EXPECT_EQ(800, out[2]);
+  EXPECT_EQ(2047, out[3]);
+
+  // Millimetre formats use 0 for no reading.
+  const uint16_t mm[] = {0, 1000, 0, 0};
+  uint16_t mm_out;
+  lptc_coderdojo::TransformDepthBoxDownscale(mm, 2, 2, 2, 2, 0, &mm_out);
+  EXPECT_EQ(1000, mm_out);
+}
+
+TEST(TransformTest, BayerToRgb_FillsCellsFromGrbgPattern) {
+  // Two 2x2 cells: G R / B G.
+  const uint8_t bayer[] = {10, 200, 20, 210,  //
+                           50, 31,  60, 41};
+  std::vector<uint8_t> rgb(4 * 2 * 3);
+  lptc_coderdojo::TransformBayerToRgb(bayer, 4, 2, rgb.data());
+  for (int pixel : {0, 1, 4, 5}) {
+    EXPECT_EQ(200, rgb[pixel * 3]) << pixel;
+    EXPECT_EQ(21, rgb[pixel * 3 + 1]) << pixel;
+    EXPECT_EQ(50, rgb[pixel * 3 + 2]) << pixel;
+  }
+  for (int pixel : {2, 3, 6, 7}) {
+    EXPECT_EQ(210, rgb[pixel * 3]) << pixel;
+    EXPECT_EQ(31, rgb[pixel * 3 + 1]) << pixel;
+    EXPECT_EQ(60, rgb[pixel * 3 + 2]) << pixel;
+  }
+}
+
+TEST(TransformTest, GreyToRgba_ReplicatesSample) {
+  const uint8_t grey[] = {0, 77, 255};
+  uint8_t rgba[12];
+  lptc_coderdojo::TransformGreyToRgba(grey, rgba, 3);
+  EXPECT_EQ(std::vector<uint8_t>({0, 0, 0, 255, 77, 77, 77, 255, 255, 255,
+                                  255, 255}),
+            std::vector<uint8_t>(rgba, rgba + 12));
+}
+
+}  // namespace
@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include "worker_pool.h"
+
+#include <thread>
+
+namespace {
+
+void ExpectEachIndexOnce(lptc_coderdojo::WorkerPool& pool, size_t count,
+                         size_t min_band) {
+  std::vector<std::atomic<int>> hits(count);
+  for (std::atomic<int>& hit : hits) hit = 0;
+  std::atomic<size_t> bands(0);
+
+  pool.ParallelFor(count, min_band, [&](size_t begin, size_t end) {
+    EXPECT_LT(begin, end);
+    if (end != count) {
+      EXPECT_GE(end - begin, min_band);
+    }
+    for (size_t i = begin; i < end; i++) hits[i]++;
+    bands++;
+  });
+
+  for (size_t i = 0; i < count; i++) ASSERT_EQ(1, hits[i]) << i;
+  EXPECT_LE(bands.load(), pool.GetThreadCount() + 1);
+}
+
+TEST(WorkerPoolTest, ParallelFor_CoversEveryIndexOnce) {
+  lptc_coderdojo::WorkerPool pool(3);
+  EXPECT_EQ(3u, pool.GetThreadCount());
+  for (size_t count : {0, 1, 7, 480, 1024}) {
+    ExpectEachIndexOnce(pool, count, 1);
+    ExpectEachIndexOnce(pool, count, 5);
+    ExpectEachIndexOnce(pool, count, 100);
+  }
+}
+
+TEST(WorkerPoolTest, ParallelFor_WithoutThreadsRunsOnCaller) {
+  lptc_coderdojo::WorkerPool pool(0);
+  std::thread::id caller = std::this_thread::get_id();
+  size_t calls = 0;
+  pool.ParallelFor(480, 1, [&](size_t begin, size_t end) {
+    EXPECT_EQ(caller, std::this_thread::get_id());
+    EXPECT_EQ(0u, begin);
+    EXPECT_EQ(480u, end);
+    calls++;
+  });
+  EXPECT_EQ(1u, calls);
+}
+
+TEST(WorkerPoolTest, ParallelFor_ConcurrentCallersBothComplete) {
+  lptc_coderdojo::WorkerPool pool(2);
+  std::thread other([&pool] {
+    for (int i = 0; i < 200; i++) ExpectEachIndexOnce(pool, 640, 16);
+  });
+  for (int i = 0; i < 200; i++) ExpectEachIndexOnce(pool, 480, 16);
+  other.join();
+}
+
+}  // namespace